@@ -1,61 +1,102 @@
 #pragma once
 #include "async/asio_concepts.h"
 
+#include <asio/any_io_executor.hpp>
 #include <asio/awaitable.hpp>
 #include <asio/co_spawn.hpp>
 #include <asio/detached.hpp>
+#include <asio/dispatch.hpp>
+#include <asio/error.hpp>
 #include <asio/io_context.hpp>
+#include <asio/system_error.hpp>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
 
 // Helper to extract value_type from awaitable
 template <typename T> struct awaitable_traits {
     using value_type = typename T::value_type;
 };
 
+/**
+ * Runs an asio awaitable on io and resumes the awaiting SharedTask on resume_on, by default io's own executor.
+ *
+ * The resumption is dispatched, so when the awaitable completes on a thread that already runs resume_on (the default case) the task
+ * resumes inline in the same handler, without another trip through the queue. Pass another executor (a strand, a different
+ * io_context...) to keep the task on the context it came from.
+ */
 template <IsAsioAwaitable T> struct AsioAwaitable {
   private:
-    asio::io_context &io_;
-    T                 expr_;
+    asio::io_context     &io_;
+    T                     expr_;
+    asio::any_io_executor resume_on_;
 
     using awaitable_return_t = typename T::value_type;
     struct dummy {};
     static constexpr bool is_awaitable_return_void = std::is_void_v<awaitable_return_t>;
-    using ResultType                               = std::conditional_t<is_awaitable_return_void, dummy, awaitable_return_t>;
+    // Empty until the operation completes, so the value type needs no default constructor and is moved out once in await_resume
+    using ResultType = std::conditional_t<is_awaitable_return_void, dummy, std::optional<awaitable_return_t>>;
     [[maybe_unused]] ResultType expr_result_;
+    std::exception_ptr exception_; // What the operation threw, rethrown by await_resume
 
   public:
     // Constructor for asio::awaitable objects
     template <typename Awaitable>
-    explicit AsioAwaitable(asio::io_context &io, Awaitable &&expr) : io_(io), expr_(std::forward<Awaitable>(expr)) {}
+    explicit AsioAwaitable(asio::io_context &io, Awaitable &&expr)
+        : io_(io), expr_(std::forward<Awaitable>(expr)), resume_on_(io.get_executor()) {}
 
-    bool await_ready() const { return io_.stopped(); }
+    template <typename Awaitable>
+    AsioAwaitable(asio::io_context &io, Awaitable &&expr, asio::any_io_executor resume_on)
+        : io_(io), expr_(std::forward<Awaitable>(expr)), resume_on_(std::move(resume_on)) {}
+
+    // A stopped io_context would not run the operation, so the await fails at once with asio::error::operation_aborted
+    bool await_ready() {
+        if (io_.stopped()) {
+            exception_ = std::make_exception_ptr(asio::system_error(asio::error::operation_aborted));
+            return true;
+        }
+        return false;
+    }
 
     template <typename U> auto await_suspend(std::coroutine_handle<U> handle) {
+        // expr_ lives in the suspended frame, so the task is held (one refcount, taken here) until the operation resumes it. The
+        // resumption itself is a single CAS on the task state, see TaskImpl, so resuming inline cannot deadlock a manual resumer
         asio::co_spawn(
             this->io_,
-            [this, weak = handle.promise().weak_from_this()]() -> asio::awaitable<void> {
-                if constexpr (is_awaitable_return_void) {
-                    co_await std::forward<T>(this->expr_);
-                } else {
-                    this->expr_result_ = co_await std::forward<T>(this->expr_);
+            [this, task = handle.promise().shared_from_this()]() mutable -> asio::awaitable<void> {
+                try {
+                    if constexpr (is_awaitable_return_void) {
+                        co_await std::forward<T>(this->expr_);
+                    } else {
+                        this->expr_result_.emplace(co_await std::forward<T>(this->expr_));
+                    }
+                } catch (...) {
+                    this->exception_ = std::current_exception();
                 }
 
-                // Need this post to avoid deadlocking yourself, incase of manual resumption
-                asio::post([weak]() {
-                    // TODO: Only resume on
-                    if (auto shared = weak.lock()) {
-                        shared->resume();
+                // *this may be gone once the task runs (inline, when resume_on_ is the running executor), so copy what is needed
+                auto resume_on = this->resume_on_;
+                asio::dispatch(resume_on, [task = std::move(task)]() {
+                    if (task) {
+                        task->resume();
                     }
                 });
             },
             asio::detached);
     }
 
-    auto await_resume() {
+    awaitable_return_t await_resume() {
+        if (exception_) {
+            std::rethrow_exception(exception_);
+        }
         if constexpr (!is_awaitable_return_void) {
-            return expr_result_;
+            return std::move(*expr_result_);
         }
     }
 };
 
 // Deduction guide for awaitable objects
-template <typename AwaitableType> AsioAwaitable(asio::io_context &, AwaitableType &&) -> AsioAwaitable<AwaitableType>;
\ No newline at end of file
+template <typename AwaitableType> AsioAwaitable(asio::io_context &, AwaitableType &&) -> AsioAwaitable<AwaitableType>;
+template <typename AwaitableType, typename Executor>
+AsioAwaitable(asio::io_context &, AwaitableType &&, Executor) -> AsioAwaitable<AwaitableType>;
\ No newline at end of file
@@ -1,31 +1,101 @@
 #pragma once
 
+#include <atomic>
+#include <cassert>
+#include <concepts>
 #include <coroutine>
+#include <cstddef>
 #include <exception>
+#include <infrastructure/frame_pool.h>
+#include <optional>
+#include <utility>
 
-template <typename Coroutine, typename T> struct promise0 {
+/**
+ * The exception that escaped a coroutine body, rethrown where the coroutine's outcome is consumed (the awaiting coroutine, result(),
+ * or the thread resuming a SharedTask) instead of terminating.
+ *
+ * Capturing costs nothing until something throws, checking is one null test. Built without exception support (-fno-exceptions) the
+ * slot is empty and every check compiles away.
+ */
+struct exception_slot {
+#if defined(__cpp_exceptions)
+    void capture() noexcept { exception_ = std::current_exception(); }
+
+    void rethrow_if_any() const {
+        if (exception_) {
+            std::rethrow_exception(exception_);
+        }
+    }
+
+    std::exception_ptr get() const noexcept { return exception_; }
+
+  private:
+    std::exception_ptr exception_;
+#else
+    void capture() noexcept { std::terminate(); }
+    void rethrow_if_any() const noexcept {}
+    std::exception_ptr get() const noexcept { return {}; }
+#endif
+};
+
+// Final awaiter, hands control to the coroutine awaiting this one (symmetric transfer, so chains of awaits do not grow the stack) or
+// back to whoever resumed it. With a countdown (when_all) only the coroutine that brings it to zero continues the awaiting one
+struct final_transfer {
+    std::coroutine_handle<>   continuation;
+    std::atomic<std::size_t> *countdown;
+
+    bool                    await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<>) const noexcept {
+        if (countdown && countdown->fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return std::noop_coroutine();
+        }
+        return continuation ? continuation : std::noop_coroutine();
+    }
+    void await_resume() const noexcept {}
+};
+
+// Frames come from rebuild::frame_pool, or from a std::pmr::memory_resource passed as (std::allocator_arg, resource, ...)
+template <typename Coroutine, typename T> struct promise0 : rebuild::pooled_frame {
     using coroutine_type = Coroutine;
     using promise_type   = promise0<Coroutine, T>;
     using return_type    = T;
 
-    // method to retrieve the result
-    T &result() { return result_; }
+    // method to retrieve the result, only valid once the coroutine has finished. Rethrows what escaped the body
+    T &result() {
+        exception_.rethrow_if_any();
+        assert(result_.has_value());
+        return *result_;
+    }
 
     coroutine_type get_return_object() { return coroutine_type{std::coroutine_handle<promise0>::from_promise(*this)}; }
 
     std::suspend_always initial_suspend() { return {}; }
-    std::suspend_always final_suspend() noexcept { return {}; }
+    final_transfer      final_suspend() noexcept { return {continuation_, countdown_}; }
 
-    auto return_value(T t) { result_ = t; }
+    // Constructed in place from the co_return operand, T needs neither a default constructor nor a copy
+    template <typename U = T>
+        requires std::constructible_from<T, U &&>
+    void return_value(U &&value) {
+        result_.emplace(std::forward<U>(value));
+    }
 
-    void unhandled_exception() { std::terminate(); }
+    void unhandled_exception() { exception_.capture(); }
+
+    // Coroutine to resume once this one finishes, see unique_coroutine::operator co_await and when_all
+    void set_continuation(std::coroutine_handle<> continuation, std::atomic<std::size_t> *countdown = nullptr) {
+        continuation_ = continuation;
+        countdown_    = countdown;
+    }
 
   private:
-    // member to store the result
-    T result_;
+    // member to store the result, empty until co_return
+    std::optional<T>          result_;
+    exception_slot            exception_;
+    std::coroutine_handle<>   continuation_;
+    std::atomic<std::size_t> *countdown_{nullptr};
 };
 
-template <typename Coroutine> struct promise0<Coroutine, void> {
+template <typename Coroutine> struct promise0<Coroutine, void> : rebuild::pooled_frame {
     using coroutine_type = Coroutine;
     using promise_type   = promise0<Coroutine, void>;
     using return_type    = void;
@@ -33,8 +103,21 @@ template <typename Coroutine> struct promise0<Coroutine, void> {
     coroutine_type get_return_object() { return coroutine_type{std::coroutine_handle<promise0>::from_promise(*this)}; }
 
     std::suspend_always initial_suspend() { return {}; }
-    std::suspend_always final_suspend() noexcept { return {}; }
+    final_transfer      final_suspend() noexcept { return {continuation_, countdown_}; }
+
+    // Rethrows what escaped the body, if anything
+    void result() const { exception_.rethrow_if_any(); }
 
     void return_void() {}
-    void unhandled_exception() { std::terminate(); }
+    void unhandled_exception() { exception_.capture(); }
+
+    void set_continuation(std::coroutine_handle<> continuation, std::atomic<std::size_t> *countdown = nullptr) {
+        continuation_ = continuation;
+        countdown_    = countdown;
+    }
+
+  private:
+    exception_slot            exception_;
+    std::coroutine_handle<>   continuation_;
+    std::atomic<std::size_t> *countdown_{nullptr};
 };
@@ -0,0 +1,415 @@
+#include <asio/awaitable.hpp>
+#include <asio/co_spawn.hpp>
+#include <asio/compose.hpp>
+#include <asio/detached.hpp>
+#include <asio/io_context.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/use_awaitable.hpp>
+#include "async/asio_awaitable.h"
+#include "async/mpsc_channel.h"
+#include "async/reference_guard.h"
+#include "async/sender_reciever.h"
+#include "async/setable_resume.h"
+#include "async/shared_coroutine.h"
+#include "async/spsc_channel.h"
+#include "async/timer_wheel.h"
+#include "async/use_shared_task.h"
+#include "async/when_all.h"
+#include "async/work_stealing_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <cstdlib>
+#include <latch>
+#include <new>
+#include <spdlog/spdlog.h>
+#include <thread>
+#include <vector>
+
+/**
+ * Benchmarks for the channel and resumption primitives (Google Benchmark). Every benchmark reports items per second and heap
+ * allocations per item, counted by the global operator new replacements below. Setup (io_context, channels, co_spawn) is not counted,
+ * each run calls setup_done() once it starts doing the work it measures.
+ *
+ * There is no build script, the headers are included as async/... and infrastructure/... from one include root:
+ *
+ *   g++ -std=c++20 -O2 -DASIO_STANDALONE -I<include root> bench_coro.cpp -o bench_coro -lbenchmark -lpthread -lspdlog -lfmt
+ *   ./bench_coro                              run everything
+ *   ./bench_coro --benchmark_filter=ping      only the ping pong benchmarks
+ */
+
+namespace {
+std::atomic<std::size_t> allocations{0};
+
+void *counted_allocate(std::size_t size, std::size_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    size = size == 0 ? 1 : size;
+    // aligned_alloc wants a multiple of the alignment
+    auto *p = alignment > alignof(std::max_align_t) ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                                                    : std::malloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+// Out of line, inlined into a delete expression gcc sees free() on a pointer from operator new (-Wmismatched-new-delete)
+[[gnu::noinline]] void counted_free(void *p) noexcept { std::free(p); }
+} // namespace
+
+// The array and nothrow forms forward to these
+void *operator new(std::size_t size) { return counted_allocate(size, 0); }
+void *operator new(std::size_t size, std::align_val_t alignment) { return counted_allocate(size, static_cast<std::size_t>(alignment)); }
+void  operator delete(void *p) noexcept { counted_free(p); }
+void  operator delete(void *p, std::size_t) noexcept { counted_free(p); }
+void  operator delete(void *p, std::align_val_t) noexcept { counted_free(p); }
+void  operator delete(void *p, std::size_t, std::align_val_t) noexcept { counted_free(p); }
+
+using namespace rebuild;
+using namespace async;
+
+namespace {
+
+constexpr int hops = 1000;
+
+// Allocation count at the start of the measured part of the current run
+std::size_t run_start = 0;
+
+// Called by a run once its setup is done, the allocations before it are not counted
+void setup_done() { run_start = allocations.load(std::memory_order_relaxed); }
+
+// Runs body once per benchmark iteration, each run covering items operations
+template <typename F> void measure(benchmark::State &state, std::size_t items, F &&body) {
+    std::size_t counted = 0;
+    for (auto _ : state) {
+        setup_done();
+        body();
+        counted += allocations.load(std::memory_order_relaxed) - run_start;
+    }
+
+    auto total = static_cast<double>(state.iterations()) * static_cast<double>(items);
+    state.SetItemsProcessed(static_cast<std::int64_t>(total));
+    state.counters["allocs/op"] = static_cast<double>(counted) / total;
+}
+
+// Sender/reciever
+
+template <typename Reciever, typename Sender> asio::awaitable<void> bounce(Reciever handle, Sender out, int n) {
+    auto exec = co_await asio::this_coro::executor;
+    int  x    = 0;
+    while (x < n) {
+        x = co_await awaitable_resumption(handle, exec);
+        out.send(x + 1);
+    }
+}
+
+void ping_pong(handoff mode) {
+    asio::io_context io;
+    auto [s1, r1] = make_sender_reciever_pair<int>(unbounded, mode);
+    auto [s2, r2] = make_sender_reciever_pair<int>(unbounded, mode);
+    s1.send(0);
+    asio::co_spawn(io, bounce(std::move(r1), std::move(s2), hops), asio::detached);
+    asio::co_spawn(io, bounce(std::move(r2), std::move(s1), hops), asio::detached);
+    setup_done();
+    io.run();
+}
+
+// The same ping pong over the lock-free channels. Both ends run on the io_context thread, so parking and waking a reciever
+// reuse the holder's parking slot. mpsc still allocates a queue node per value and mpmc one waiter per receive
+template <typename MakePair> void lock_free_ping_pong(MakePair make_pair) {
+    asio::io_context io;
+    auto [s1, r1] = make_pair();
+    auto [s2, r2] = make_pair();
+    s1.send(0);
+    asio::co_spawn(io, bounce(std::move(r1), std::move(s2), hops), asio::detached);
+    asio::co_spawn(io, bounce(std::move(r2), std::move(s1), hops), asio::detached);
+    setup_done();
+    io.run();
+}
+
+template <typename Reciever> asio::awaitable<void> drain(Reciever handle, int n, long &sum) {
+    auto exec = co_await asio::this_coro::executor;
+    for (int i = 0; i < n; ++i) {
+        sum += co_await awaitable_resumption(handle, exec);
+    }
+}
+
+// All values are queued before the reciever runs, every receive completes immediately
+void one_way_queued() {
+    asio::io_context io;
+    long             sum = 0;
+    auto [s, r]          = make_sender_reciever_pair<int>();
+    asio::co_spawn(io, drain(std::move(r), hops, sum), asio::detached);
+    setup_done();
+    for (int i = 0; i < hops; ++i) {
+        s.send(i);
+    }
+    io.run();
+    benchmark::DoNotOptimize(sum);
+}
+
+// The reciever is parked before every send, every send wakes it
+void one_way_waiting() {
+    asio::io_context io;
+    long             sum = 0;
+    auto [s, r]          = make_sender_reciever_pair<int>();
+    asio::co_spawn(io, drain(std::move(r), hops, sum), asio::detached);
+    io.poll();
+    setup_done();
+    for (int i = 0; i < hops; ++i) {
+        s.send(i);
+        io.poll();
+    }
+    benchmark::DoNotOptimize(sum);
+}
+
+template <typename Reciever> asio::awaitable<void> drain_with_deadline(Reciever handle, int n, long &sum) {
+    auto exec = co_await asio::this_coro::executor;
+    for (int i = 0; i < n; ++i) {
+        sum += *co_await awaitable_receive_for(handle, std::chrono::seconds(10), exec);
+    }
+}
+
+// As one_way_waiting, every parked receive also has a deadline in the executor's timer wheel
+void one_way_waiting_for() {
+    asio::io_context io;
+    long             sum = 0;
+    auto [s, r]          = make_sender_reciever_pair<int>();
+    asio::co_spawn(io, drain_with_deadline(std::move(r), hops, sum), asio::detached);
+    io.poll();
+    setup_done();
+    for (int i = 0; i < hops; ++i) {
+        s.send(i);
+        io.poll();
+    }
+    benchmark::DoNotOptimize(sum);
+}
+
+// Sleeps
+
+asio::awaitable<void> sleep_on_wheel() {
+    auto exec = co_await asio::this_coro::executor;
+    co_await sleep_for(std::chrono::milliseconds(1), asio::use_awaitable, exec);
+}
+
+asio::awaitable<void> sleep_on_timer() {
+    asio::steady_timer timer(co_await asio::this_coro::executor, std::chrono::milliseconds(1));
+    co_await timer.async_wait(asio::use_awaitable);
+}
+
+// hops concurrent sleeps, all due in the same tick. The wheel expires them in one batch, steady_timers go through asio's timer heap
+template <typename Sleep> void concurrent_sleeps(Sleep sleep) {
+    asio::io_context io;
+    for (int i = 0; i < hops; ++i) {
+        asio::co_spawn(io, sleep(), asio::detached);
+    }
+    setup_done();
+    io.run();
+}
+
+// setable_resume
+
+asio::awaitable<void> wait_resumes(setable_resume<void(int)> &r, int n, long &sum) {
+    auto setter = r.weak_ptr().lock();
+    for (int i = 0; i < n; ++i) {
+        sum += co_await asio::async_compose<decltype(asio::use_awaitable), void(int)>(
+            [&setter](auto &&self) { (*setter)(std::forward<decltype(self)>(self)); }, asio::use_awaitable);
+    }
+}
+
+// Resumed from outside the io_context, like a foreign callback would, so every resume posts the completion. One resume per wait
+void setable_resume_round_trip() {
+    asio::io_context          io;
+    setable_resume<void(int)> r;
+    long                      sum = 0;
+    asio::co_spawn(io, wait_resumes(r, hops, sum), asio::detached);
+    io.poll();
+    setup_done();
+    for (int i = 0; i < hops; ++i) {
+        r.resume(std::move(i));
+        io.poll();
+    }
+    benchmark::DoNotOptimize(sum);
+}
+
+// AsioAwaitable
+
+asio::awaitable<void> nothing() { co_return; }
+
+SharedTask await_asio(asio::io_context &io, int n) {
+    for (int i = 0; i < n; ++i) {
+        co_await AsioAwaitable(io, nothing());
+    }
+}
+
+void asio_awaitable_round_trip() {
+    asio::io_context io;
+    TaskHandle       task = await_asio(io, hops);
+    setup_done();
+    task->try_resume();
+    while (!task->is_done()) {
+        io.restart();
+        io.poll();
+    }
+}
+
+SharedTask await_posts(asio::io_context &io, int n) {
+    for (int i = 0; i < n; ++i) {
+        co_await asio::post(io, use_shared_task);
+    }
+}
+
+// Same round trip as asio_awaitable_round_trip, without the asio::awaitable frame and co_spawn per operation
+void use_shared_task_round_trip() {
+    asio::io_context io;
+    TaskHandle       task = await_posts(io, hops);
+    setup_done();
+    task->try_resume();
+    io.run();
+}
+
+// work_stealing_pool
+
+SharedTask hop_on(work_stealing_pool &pool, int n, std::latch &finished) {
+    for (int i = 0; i < n; ++i) {
+        co_await schedule_on(pool);
+    }
+    finished.count_down();
+}
+
+// Many tasks each hopping onto the pool, most hops land on the worker's own deque, idle workers steal
+void schedule_on_pool(work_stealing_pool &pool, std::size_t tasks) {
+    std::latch              finished(static_cast<std::ptrdiff_t>(tasks));
+    std::vector<TaskHandle> handles;
+    handles.reserve(tasks);
+    for (std::size_t t = 0; t < tasks; ++t) {
+        handles.push_back(hop_on(pool, hops, finished));
+        handles.back()->try_resume();
+    }
+    finished.wait();
+}
+
+// when_all
+
+task<int> child(int x) { co_return x; }
+
+task<long> fan_out(int n) {
+    long sum = 0;
+    for (int i = 0; i < n; ++i) {
+        auto [a, b, c, d] = co_await when_all(child(i), child(i), child(i), child(i));
+        sum += a + b + c + d;
+    }
+    co_return sum;
+}
+
+// One countdown per when_all, the child frames come from the frame pool
+void when_all_round_trip() {
+    auto t = fan_out(hops);
+    setup_done();
+    t.resume();
+    benchmark::DoNotOptimize(t.result());
+}
+
+// reference_guard
+
+// One guard for all benchmark threads of a Counter, google benchmark starts the threads once and lines them up before the timed loop
+template <typename Counter> reference_guard<int, Counter> &shared_guard() {
+    static int                           object = 0;
+    static reference_guard<int, Counter> guard(object);
+    return guard;
+}
+
+void BM_ping_pong_post(benchmark::State &state) {
+    measure(state, 2 * hops, [] { ping_pong(handoff::post); });
+}
+void BM_ping_pong_direct(benchmark::State &state) {
+    measure(state, 2 * hops, [] { ping_pong(handoff::direct); });
+}
+void BM_ping_pong_spsc(benchmark::State &state) {
+    measure(state, 2 * hops, [] { lock_free_ping_pong([] { return make_spsc_sender_reciever_pair<int>(64); }); });
+}
+void BM_ping_pong_mpsc(benchmark::State &state) {
+    measure(state, 2 * hops, [] { lock_free_ping_pong([] { return make_mpsc_sender_reciever_pair<int>(); }); });
+}
+void BM_ping_pong_mpmc(benchmark::State &state) {
+    measure(state, 2 * hops, [] { lock_free_ping_pong([] { return make_mpmc_sender_reciever_pair<int>(); }); });
+}
+void BM_one_way_queued(benchmark::State &state) { measure(state, hops, one_way_queued); }
+void BM_one_way_waiting(benchmark::State &state) { measure(state, hops, one_way_waiting); }
+void BM_one_way_waiting_for(benchmark::State &state) { measure(state, hops, one_way_waiting_for); }
+void BM_sleep_for_wheel(benchmark::State &state) {
+    measure(state, hops, [] { concurrent_sleeps(sleep_on_wheel); });
+}
+void BM_sleep_for_steady_timer(benchmark::State &state) {
+    measure(state, hops, [] { concurrent_sleeps(sleep_on_timer); });
+}
+void BM_setable_resume(benchmark::State &state) { measure(state, hops, setable_resume_round_trip); }
+void BM_asio_awaitable(benchmark::State &state) { measure(state, hops, asio_awaitable_round_trip); }
+void BM_use_shared_task(benchmark::State &state) { measure(state, hops, use_shared_task_round_trip); }
+
+void BM_when_all(benchmark::State &state) { measure(state, hops, when_all_round_trip); }
+
+void BM_schedule_on(benchmark::State &state) {
+    auto               tasks = static_cast<std::size_t>(state.range(0));
+    work_stealing_pool pool;
+    measure(state, tasks * hops, [&pool, tasks] { schedule_on_pool(pool, tasks); });
+}
+
+// Runs on every benchmark thread, allocs/op averages the global count over the threads since each of them sees all of it
+template <typename Counter> void BM_make_reference(benchmark::State &state) {
+    auto &guard = shared_guard<Counter>();
+    auto  start = allocations.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        auto ref = guard.make_reference();
+        benchmark::DoNotOptimize(ref.get());
+    }
+
+    auto counted = allocations.load(std::memory_order_relaxed) - start;
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+    state.counters["allocs/op"] =
+        benchmark::Counter(static_cast<double>(counted), benchmark::Counter::kAvgThreads | benchmark::Counter::kAvgIterations);
+}
+
+// 1, 4 and every core, without running a thread count twice on a 1 or 4 core machine
+void reference_threads(benchmark::internal::Benchmark *b) {
+    std::vector<int> counts{1, 4, static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U))};
+    std::sort(counts.begin(), counts.end());
+    counts.erase(std::unique(counts.begin(), counts.end()), counts.end());
+    for (auto n : counts) {
+        b->Threads(n);
+    }
+    b->UseRealTime();
+}
+
+BENCHMARK(BM_ping_pong_post);
+BENCHMARK(BM_ping_pong_direct);
+BENCHMARK(BM_ping_pong_spsc);
+BENCHMARK(BM_ping_pong_mpsc);
+BENCHMARK(BM_ping_pong_mpmc);
+BENCHMARK(BM_one_way_queued);
+BENCHMARK(BM_one_way_waiting);
+BENCHMARK(BM_one_way_waiting_for);
+BENCHMARK(BM_sleep_for_wheel);
+BENCHMARK(BM_sleep_for_steady_timer);
+BENCHMARK(BM_setable_resume);
+BENCHMARK(BM_asio_awaitable);
+BENCHMARK(BM_use_shared_task);
+BENCHMARK(BM_when_all);
+BENCHMARK(BM_schedule_on)->Arg(1)->Arg(64)->UseRealTime();
+BENCHMARK(BM_make_reference<single_counter>)->Apply(reference_threads);
+BENCHMARK(BM_make_reference<striped_counter<>>)->Apply(reference_threads);
+
+} // namespace
+
+int main(int argc, char **argv) {
+    spdlog::set_level(spdlog::level::off);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
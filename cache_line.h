@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+namespace rebuild {
+
+// std::hardware_destructive_interference_size is not usable in headers without ABI warnings (gcc -Winterference-size), and 64 bytes is
+// right for every x86_64 and most aarch64 targets we run on.
+inline constexpr std::size_t cache_line_size = 64;
+
+} // namespace rebuild
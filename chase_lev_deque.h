@@ -0,0 +1,114 @@
+#pragma once
+
+#include <infrastructure/cache_line.h>
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rebuild {
+
+/**
+ * Unbounded, lock-free work-stealing deque of pointers (Chase-Lev, with the C11 memory orders of Le et al. 2013).
+ *
+ * The owning thread pushes and pops at the bottom (LIFO, so recently scheduled and cache warm work runs first), any other thread may
+ * steal from the top (FIFO). Only the owner touches the bottom in the common case, a pop synchronizes with thieves only when one element
+ * is left. The slot array doubles when full; retired arrays are kept until the deque is destroyed because a thief may still read them.
+ */
+template <typename T> class chase_lev_deque {
+  public:
+    explicit chase_lev_deque(std::size_t capacity = 256) {
+        auto initial = std::make_unique<ring>(std::bit_ceil(capacity < 2 ? 2 : capacity));
+        ring_.store(initial.get(), std::memory_order_relaxed);
+        rings_.push_back(std::move(initial));
+    }
+
+    chase_lev_deque(const chase_lev_deque &)            = delete;
+    chase_lev_deque &operator=(const chase_lev_deque &) = delete;
+
+    // Owner side
+    void push(T *item) {
+        auto  bottom = bottom_.load(std::memory_order_relaxed);
+        auto  top    = top_.load(std::memory_order_acquire);
+        auto *slots  = ring_.load(std::memory_order_relaxed);
+        if (bottom - top > static_cast<std::int64_t>(slots->mask)) {
+            slots = this->grow(slots, top, bottom);
+        }
+        slots->at(bottom).store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    // Owner side. Returns nullptr if the deque is empty
+    T *pop() {
+        auto  bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        auto *slots  = ring_.load(std::memory_order_relaxed);
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = top_.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        auto *item = slots->at(bottom).load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // Last element, race the thieves for it
+            if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread. Returns nullptr if the deque is empty or another thread won the race for the top element
+    T *steal() {
+        auto top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return nullptr;
+        }
+        auto *item = ring_.load(std::memory_order_acquire)->at(top).load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    // Approximate when called concurrently
+    bool empty() const { return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed); }
+
+  private:
+    struct ring {
+        explicit ring(std::size_t capacity) : mask(capacity - 1), slots(new std::atomic<T *>[capacity]) {}
+
+        std::atomic<T *> &at(std::int64_t index) { return slots[static_cast<std::size_t>(index) & mask]; }
+
+        std::size_t                         mask;
+        std::unique_ptr<std::atomic<T *>[]> slots;
+    };
+
+    // Owner side
+    ring *grow(ring *old, std::int64_t top, std::int64_t bottom) {
+        auto bigger = std::make_unique<ring>((old->mask + 1) * 2);
+        for (auto i = top; i < bottom; ++i) {
+            bigger->at(i).store(old->at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        auto *slots = bigger.get();
+        rings_.push_back(std::move(bigger));
+        ring_.store(slots, std::memory_order_release);
+        return slots;
+    }
+
+    alignas(cache_line_size) std::atomic<std::int64_t> top_{0};
+    alignas(cache_line_size) std::atomic<std::int64_t> bottom_{0};
+    std::atomic<ring *>                                ring_{nullptr};
+    std::vector<std::unique_ptr<ring>>                 rings_; // Owner side, every array ever used
+};
+
+} // namespace rebuild
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+namespace rebuild {
+
+/**
+ * Thread local, size class free lists for coroutine frames and other short lived, task sized blocks.
+ *
+ * Sizes are rounded up to a multiple of size_class_granularity, blocks up to size_classes * size_class_granularity bytes are cached per
+ * thread (at most max_cached_per_class per class) instead of going back to the global heap. A block freed on another thread than the
+ * one that allocated it simply joins the cache of the freeing thread. Larger blocks use global operator new/delete directly.
+ *
+ * Define FRAME_POOL_DISABLE to route everything to global operator new/delete, e.g. when hunting leaks with ASAN.
+ */
+class frame_pool {
+  public:
+    static constexpr std::size_t size_class_granularity = 64;
+    static constexpr std::size_t size_classes           = 16;
+    static constexpr std::size_t max_cached_per_class   = 128;
+
+    // Per thread counters, hits + misses is the number of pooled allocations
+    struct statistics {
+        std::size_t hits{0};
+        std::size_t misses{0};
+        std::size_t unpooled{0};
+    };
+
+    static void *allocate(std::size_t size) {
+#ifndef FRAME_POOL_DISABLE
+        auto  index = size_class(size);
+        auto *cache = local();
+        if (index >= size_classes) {
+            if (cache) {
+                ++cache->stats.unpooled;
+            }
+            return ::operator new(size);
+        }
+        if (cache) {
+            auto &bucket = cache->buckets[index];
+            if (bucket.head) {
+                ++cache->stats.hits;
+                --bucket.count;
+                return std::exchange(bucket.head, bucket.head->next);
+            }
+            ++cache->stats.misses;
+        }
+        // Always the full class size, the block may end up in any thread's cache
+        return ::operator new((index + 1) * size_class_granularity);
+#else
+        return ::operator new(size);
+#endif
+    }
+
+    static void deallocate(void *p, std::size_t size) noexcept {
+#ifndef FRAME_POOL_DISABLE
+        auto  index = size_class(size);
+        auto *cache = local();
+        if (cache && index < size_classes && cache->buckets[index].count < max_cached_per_class) {
+            auto &bucket = cache->buckets[index];
+            bucket.head  = ::new (p) free_block{bucket.head};
+            ++bucket.count;
+            return;
+        }
+#endif
+        ::operator delete(p);
+    }
+
+    // Counters of the calling thread
+    static statistics stats() noexcept {
+        auto *cache = local();
+        return cache ? cache->stats : statistics{};
+    }
+
+    static void reset_stats() noexcept {
+        if (auto *cache = local()) {
+            cache->stats = {};
+        }
+    }
+
+  private:
+    struct free_block {
+        free_block *next;
+    };
+
+    struct bucket {
+        free_block *head{nullptr};
+        std::size_t count{0};
+    };
+
+    struct thread_cache {
+        std::array<bucket, size_classes> buckets;
+        statistics                       stats;
+
+        ~thread_cache() {
+            // Frames released later during thread exit go straight to the heap
+            exiting = true;
+            for (auto &b : buckets) {
+                while (b.head) {
+                    ::operator delete(std::exchange(b.head, b.head->next));
+                }
+            }
+        }
+    };
+
+    static constexpr std::size_t size_class(std::size_t size) noexcept {
+        return (size + size_class_granularity - 1) / size_class_granularity - 1;
+    }
+
+    static thread_cache *local() noexcept {
+        if (exiting) {
+            return nullptr;
+        }
+        thread_local thread_cache cache;
+        return &cache;
+    }
+
+    static inline thread_local bool exiting = false;
+};
+
+// Standard allocator on top of frame_pool, e.g. for std::allocate_shared of per task state
+template <typename T> struct frame_pool_allocator {
+    using value_type = T;
+
+    frame_pool_allocator() noexcept = default;
+    template <typename U> frame_pool_allocator(const frame_pool_allocator<U> &) noexcept {}
+
+    T   *allocate(std::size_t n) { return static_cast<T *>(frame_pool::allocate(n * sizeof(T))); }
+    void deallocate(T *p, std::size_t n) noexcept { frame_pool::deallocate(p, n * sizeof(T)); }
+
+    template <typename U> bool operator==(const frame_pool_allocator<U> &) const noexcept { return true; }
+};
+
+/**
+ * Mixin for promise types, coroutine frames are then drawn from frame_pool.
+ *
+ * A coroutine whose first parameters are (std::allocator_arg_t, std::pmr::memory_resource *) or
+ * (std::allocator_arg_t, const std::pmr::polymorphic_allocator<> &) gets its frame from that resource instead, e.g.
+ *   SharedTask work(std::allocator_arg_t, std::pmr::memory_resource *, int job);
+ *   work(std::allocator_arg, &arena, 42);
+ */
+struct pooled_frame {
+    static void *operator new(std::size_t size) { return allocate_frame(size, nullptr); }
+
+    template <typename... Args>
+    static void *operator new(std::size_t size, std::allocator_arg_t, std::pmr::memory_resource *resource, Args &&...) {
+        return allocate_frame(size, resource);
+    }
+
+    template <typename... Args>
+    static void *operator new(std::size_t size, std::allocator_arg_t, const std::pmr::polymorphic_allocator<> &allocator, Args &&...) {
+        return allocate_frame(size, allocator.resource());
+    }
+
+    static void operator delete(void *p, std::size_t size) noexcept { release_frame(p, size); }
+
+    // Match the placement forms of operator new, a frame is always freed with the sized form above. Declared so every operator new has
+    // its operator delete, gcc pairs them for -Wmismatched-new-delete
+    template <typename... Args>
+    static void operator delete(void *p, std::allocator_arg_t, std::pmr::memory_resource *, Args &&...) noexcept {
+        release_frame(p, header_of(p)->size);
+    }
+
+    template <typename... Args>
+    static void operator delete(void *p, std::allocator_arg_t, const std::pmr::polymorphic_allocator<> &, Args &&...) noexcept {
+        release_frame(p, header_of(p)->size);
+    }
+
+  private:
+    // Remembers where the frame came from, the placement forms of operator delete do not even get the size (it fits in the padding)
+    struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) frame_header {
+        std::pmr::memory_resource *resource;
+        std::size_t                size;
+    };
+
+    static frame_header *header_of(void *p) noexcept { return static_cast<frame_header *>(p) - 1; }
+
+    static void *allocate_frame(std::size_t size, std::pmr::memory_resource *resource) {
+        auto  total = size + sizeof(frame_header);
+        void *raw   = resource ? resource->allocate(total, alignof(frame_header)) : frame_pool::allocate(total);
+        return ::new (raw) frame_header{resource, size} + 1;
+    }
+
+    static void release_frame(void *p, std::size_t size) noexcept {
+        auto *header = header_of(p);
+        if (auto *resource = header->resource) {
+            header->~frame_header();
+            resource->deallocate(header, size + sizeof(frame_header), alignof(frame_header));
+        } else {
+            frame_pool::deallocate(header, size + sizeof(frame_header));
+        }
+    }
+};
+
+} // namespace rebuild
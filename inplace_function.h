@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace rebuild {
+
+// Primary template
+template <typename Signature, std::size_t Capacity = 4 * sizeof(void *), std::size_t Alignment = alignof(std::max_align_t)>
+class inplace_function;
+
+/**
+ * Move-only function wrapper with fixed inline storage, it never allocates.
+ *
+ * Callables that do not fit Capacity/Alignment are rejected at compile time, so a hot path that stores its handlers in an
+ * inplace_function stays allocation free and a capture that grows too large becomes a build error instead of a silent heap allocation.
+ */
+template <typename R, typename... Args, std::size_t Capacity, std::size_t Alignment>
+class inplace_function<R(Args...), Capacity, Alignment> {
+  private:
+    // Manual vtable, one static instance per callable type
+    struct vtable {
+        R (*invoke)(void *, Args &&...);
+        void (*move)(void *dst, void *src) noexcept; // Move constructs into dst and destroys src
+        void (*destroy)(void *) noexcept;
+    };
+
+    template <typename Callable> static R invoke_impl(void *storage, Args &&...args) {
+        if constexpr (std::is_void_v<R>) {
+            std::invoke(*static_cast<Callable *>(storage), std::forward<Args>(args)...);
+        } else {
+            return std::invoke(*static_cast<Callable *>(storage), std::forward<Args>(args)...);
+        }
+    }
+
+    template <typename Callable> static void move_impl(void *dst, void *src) noexcept {
+        ::new (dst) Callable(std::move(*static_cast<Callable *>(src)));
+        static_cast<Callable *>(src)->~Callable();
+    }
+
+    template <typename Callable> static void destroy_impl(void *storage) noexcept { static_cast<Callable *>(storage)->~Callable(); }
+
+    template <typename Callable>
+    static constexpr vtable vtable_for{&invoke_impl<Callable>, &move_impl<Callable>, &destroy_impl<Callable>};
+
+    alignas(Alignment) mutable std::byte storage_[Capacity];
+    const vtable *vtable_{nullptr};
+
+    void *storage() const noexcept { return static_cast<void *>(storage_); }
+
+    void reset() noexcept {
+        if (vtable_) {
+            std::exchange(vtable_, nullptr)->destroy(this->storage());
+        }
+    }
+
+    void move_from(inplace_function &other) noexcept {
+        if (other.vtable_) {
+            other.vtable_->move(this->storage(), other.storage());
+            vtable_ = std::exchange(other.vtable_, nullptr);
+        }
+    }
+
+  public:
+    static constexpr std::size_t capacity  = Capacity;
+    static constexpr std::size_t alignment = Alignment;
+
+    // Default constructor (empty function)
+    inplace_function() noexcept = default;
+
+    // Nullptr constructor (empty function)
+    inplace_function(std::nullptr_t) noexcept : inplace_function() {}
+
+    // Move constructor
+    inplace_function(inplace_function &&other) noexcept { this->move_from(other); }
+
+    // Copy constructor deleted (move-only semantics)
+    inplace_function(const inplace_function &) = delete;
+
+    // Constructor from callable
+    template <typename F>
+    inplace_function(F &&f)
+        requires(!std::is_same_v<std::decay_t<F>, inplace_function> && std::is_invocable_r_v<R, F, Args...>)
+    {
+        using callable_type = std::decay_t<F>;
+        static_assert(sizeof(callable_type) <= Capacity, "callable does not fit the inplace_function, raise Capacity or capture less");
+        static_assert(Alignment % alignof(callable_type) == 0, "callable is over aligned for the inplace_function, raise Alignment");
+        // Moving the stored callable is what makes the wrapper's own moves noexcept
+        static_assert(std::is_nothrow_move_constructible_v<callable_type>, "callable must be nothrow move constructible");
+
+        ::new (this->storage()) callable_type(std::forward<F>(f));
+        vtable_ = &vtable_for<callable_type>;
+    }
+
+    ~inplace_function() { this->reset(); }
+
+    // Move assignment
+    inplace_function &operator=(inplace_function &&other) noexcept {
+        if (this != &other) {
+            this->reset();
+            this->move_from(other);
+        }
+        return *this;
+    }
+
+    // Copy assignment deleted (move-only semantics)
+    inplace_function &operator=(const inplace_function &) = delete;
+
+    // Assignment from nullptr
+    inplace_function &operator=(std::nullptr_t) noexcept {
+        this->reset();
+        return *this;
+    }
+
+    // Assignment from callable
+    template <typename F>
+    inplace_function &operator=(F &&f)
+        requires(!std::is_same_v<std::decay_t<F>, inplace_function> && std::is_invocable_r_v<R, F, Args...>)
+    {
+        inplace_function tmp(std::forward<F>(f));
+        return *this = std::move(tmp);
+    }
+
+    // Function call operator
+    R operator()(Args... args) const {
+        assert(vtable_ && "callbable is nullptr");
+        return vtable_->invoke(this->storage(), std::forward<Args>(args)...);
+    }
+
+    // Boolean conversion operator
+    explicit operator bool() const noexcept { return vtable_ != nullptr; }
+};
+
+} // namespace rebuild
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <cassert>
+#include <cstddef>
 #include <functional>
 #include <memory>
+#include <new>
 #include <type_traits>
 #include <utility>
 
@@ -21,6 +23,12 @@ template <typename Signature> using move_only_function = std::move_only_function
 
 // Custom implementation for pre-C++23
 
+// Bytes of inline storage, callables up to this size (with a nothrow move) are stored without allocating. Defaults to 4 pointers, which
+// fits the typical handler lambda capturing a couple of pointers and a shared_ptr
+#ifndef MOVE_ONLY_FUNCTION_INLINE_SIZE
+#define MOVE_ONLY_FUNCTION_INLINE_SIZE (4 * sizeof(void *))
+#endif
+
 // Primary template
 template <typename Signature> class move_only_function;
 
@@ -36,23 +44,74 @@ template <typename R, typename F, typename... Args> R invoke_and_return(F &&f, A
 // Specialization for any function signature R(Args...)
 template <typename R, typename... Args> class move_only_function<R(Args...)> {
   private:
-    // Type-erased interface for callable objects
-    struct callable_base {
-        virtual R invoke(Args...) = 0;
-        virtual ~callable_base()  = default;
-    };
+    static constexpr std::size_t inline_size  = MOVE_ONLY_FUNCTION_INLINE_SIZE;
+    static constexpr std::size_t inline_align = alignof(void *);
 
-    // Concrete implementation for specific callable types
-    template <typename Callable> struct callable_impl : callable_base {
-        Callable func;
+    // Small callables live in the buffer, everything else on the heap. A throwing move would break the noexcept moves of this class
+    template <typename Callable>
+    static constexpr bool stored_inline =
+        sizeof(Callable) <= inline_size && alignof(Callable) <= inline_align && std::is_nothrow_move_constructible_v<Callable>;
 
-        template <typename F> explicit callable_impl(F &&f) : func(std::forward<F>(f)) {}
+    union storage {
+        alignas(inline_align) std::byte buffer[inline_size];
+        void *heap;
+    };
 
-        R invoke(Args... args) override { return invoke_and_return<R>(func, std::forward<Args>(args)...); }
+    // Manual vtable, one static instance per callable type
+    struct vtable {
+        R (*invoke)(storage &, Args &&...);
+        void (*move)(storage &dst, storage &src) noexcept; // Move constructs into dst and destroys src
+        void (*destroy)(storage &) noexcept;
     };
 
-    // Storage for the callable
-    std::unique_ptr<callable_base> callable;
+    template <typename Callable> static Callable *target(storage &s) noexcept {
+        if constexpr (stored_inline<Callable>) {
+            return std::launder(reinterpret_cast<Callable *>(s.buffer));
+        } else {
+            return static_cast<Callable *>(s.heap);
+        }
+    }
+
+    template <typename Callable> static R invoke_impl(storage &s, Args &&...args) {
+        return invoke_and_return<R>(*target<Callable>(s), std::forward<Args>(args)...);
+    }
+
+    template <typename Callable> static void move_impl(storage &dst, storage &src) noexcept {
+        if constexpr (stored_inline<Callable>) {
+            ::new (static_cast<void *>(dst.buffer)) Callable(std::move(*target<Callable>(src)));
+            target<Callable>(src)->~Callable();
+        } else {
+            dst.heap = std::exchange(src.heap, nullptr);
+        }
+    }
+
+    template <typename Callable> static void destroy_impl(storage &s) noexcept {
+        if constexpr (stored_inline<Callable>) {
+            target<Callable>(s)->~Callable();
+        } else {
+            delete target<Callable>(s);
+        }
+    }
+
+    template <typename Callable>
+    static constexpr vtable vtable_for{&invoke_impl<Callable>, &move_impl<Callable>, &destroy_impl<Callable>};
+
+    // Storage for the callable, mutable since a const call may still mutate the callable (like the heap stored one did before)
+    mutable storage storage_;
+    const vtable   *vtable_{nullptr};
+
+    void reset() noexcept {
+        if (vtable_) {
+            std::exchange(vtable_, nullptr)->destroy(storage_);
+        }
+    }
+
+    void move_from(move_only_function &other) noexcept {
+        if (other.vtable_) {
+            other.vtable_->move(storage_, other.storage_);
+            vtable_ = std::exchange(other.vtable_, nullptr);
+        }
+    }
 
   public:
     // Default constructor (empty function)
@@ -62,7 +121,7 @@ template <typename R, typename... Args> class move_only_function<R(Args...)> {
     move_only_function(std::nullptr_t) noexcept : move_only_function() {}
 
     // Move constructor
-    move_only_function(move_only_function &&other) noexcept = default;
+    move_only_function(move_only_function &&other) noexcept { this->move_from(other); }
 
     // Copy constructor deleted (move-only semantics)
     move_only_function(const move_only_function &) = delete;
@@ -72,18 +131,32 @@ template <typename R, typename... Args> class move_only_function<R(Args...)> {
     move_only_function(F &&f)
         requires(!std::is_same_v<std::decay_t<F>, move_only_function> && std::is_invocable_r_v<R, F, Args...>)
     {
-        callable = std::make_unique<callable_impl<std::decay_t<F>>>(std::forward<F>(f));
+        using callable_type = std::decay_t<F>;
+        if constexpr (stored_inline<callable_type>) {
+            ::new (static_cast<void *>(storage_.buffer)) callable_type(std::forward<F>(f));
+        } else {
+            storage_.heap = new callable_type(std::forward<F>(f));
+        }
+        vtable_ = &vtable_for<callable_type>;
     }
 
+    ~move_only_function() { this->reset(); }
+
     // Move assignment
-    move_only_function &operator=(move_only_function &&other) noexcept = default;
+    move_only_function &operator=(move_only_function &&other) noexcept {
+        if (this != &other) {
+            this->reset();
+            this->move_from(other);
+        }
+        return *this;
+    }
 
     // Copy assignment deleted (move-only semantics)
     move_only_function &operator=(const move_only_function &) = delete;
 
     // Assignment from nullptr
     move_only_function &operator=(std::nullptr_t) noexcept {
-        callable.reset();
+        this->reset();
         return *this;
     }
 
@@ -93,21 +166,24 @@ template <typename R, typename... Args> class move_only_function<R(Args...)> {
         requires(!std::is_same_v<std::decay_t<F>, move_only_function> && std::is_invocable_r_v<R, F, Args...>)
     {
         move_only_function tmp(std::forward<F>(f));
-        callable = std::move(tmp.callable);
-        return *this;
+        return *this = std::move(tmp);
     }
 
     // Function call operator
     R operator()(Args... args) const {
-        assert(callable && "callbable is nullptr");
-        return callable->invoke(std::forward<Args>(args)...);
+        assert(vtable_ && "callbable is nullptr");
+        return vtable_->invoke(storage_, std::forward<Args>(args)...);
     }
 
     // Boolean conversion operator
-    explicit operator bool() const noexcept { return callable != nullptr; }
+    explicit operator bool() const noexcept { return vtable_ != nullptr; }
 
     // Swap function
-    void swap(move_only_function &other) noexcept { callable.swap(other.callable); }
+    void swap(move_only_function &other) noexcept {
+        move_only_function tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
 };
 
 // Non-member swap
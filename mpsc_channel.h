@@ -0,0 +1,337 @@
+#pragma once
+#include <async/sender_reciever.h>
+#include <atomic>
+#include <infrastructure/mpsc_queue.h>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace rebuild::async {
+
+/**
+ * Unbounded multi-producer/single-consumer holder, senders are copyable and may live on any thread.
+ *
+ * Values are pushed into a lock-free intrusive queue. The single reciever parks like in spsc_holder (store -> fence -> load on waiting_),
+ * so a send costs one exchange on the queue head plus a fence and a load. A woken reciever that finds nothing (another sender was half
+ * way through its push) simply parks again, that sender wakes it once its node is linked.
+ */
+template <typename... Args> struct mpsc_holder : std::enable_shared_from_this<mpsc_holder<Args...>> {
+    using ptr        = std::shared_ptr<mpsc_holder>;
+    using signature  = void(Args...);
+    using args_type  = std::tuple<Args...>;
+    using value_type = detail::batch_value<Args...>::type;
+
+    static auto make_holder() { return std::make_shared<mpsc_holder>(); }
+
+    // Asio entrypoint for async_compose. Will make the handle ready
+    template <typename Self, typename Executor>
+    [[nodiscard("if false, then the sender is gone AND the queue empty")]] bool operator()(Self &&self, Executor &&exec) {
+        if (this->complete_from_queue(self, exec)) {
+            return true;
+        }
+        if (this->is_closed()) {
+            // The last sender may have pushed its values right before leaving
+            return this->complete_from_queue(self, exec);
+        }
+
+        // Once parked, the reciever may be completed and destroyed on another thread before this call returns
+        auto keep_alive = this->shared_from_this();
+
+        parked_.park(std::move(self), [this, exec](auto &self) {
+            // Park again if the wake raced with a half linked push. If the channel is closed the operation is abandoned
+            [[maybe_unused]] auto parked = (*this)(std::move(self), exec);
+        });
+        this->park();
+        return true;
+    }
+
+    // Asio entrypoint for receive. Completes with the next value, or with an empty optional once the channel is closed and drained
+    template <typename Self, typename Executor> void receive(Self &&self, Executor &&exec) {
+        if (this->template complete_from_queue<true>(self, exec)) {
+            return;
+        }
+        if (this->is_closed()) {
+            // The last sender may have pushed its values right before leaving
+            if (!this->template complete_from_queue<true>(self, exec)) {
+                detail::complete_from_tuple(self, exec, std::make_tuple(std::optional<value_type>()));
+            }
+            return;
+        }
+
+        // Once parked, the reciever may be completed and destroyed on another thread before this call returns
+        auto keep_alive = this->shared_from_this();
+
+        parked_.park(std::move(self), [this, exec](auto &self) {
+            // Park again if the wake raced with a half linked push, a closed channel completes from there
+            this->receive(std::move(self), exec);
+        });
+        this->park();
+    }
+
+    // Any thread. Returns false if the reciever is gone
+    template <typename... U> bool send(U &&...args) { return this->try_send(std::forward<U>(args)...) == send_result::sent; }
+
+    // Unbounded, never reports send_result::full
+    template <typename... U> send_result try_send(U &&...args) {
+        if (!this->has_reciever()) {
+            return send_result::closed;
+        }
+        args_.emplace(std::forward<U>(args)...);
+        this->wake_reciever();
+        return send_result::sent;
+    }
+
+    bool has_sender() const { return senders_.load(std::memory_order_acquire) != 0; }
+    bool has_reciever() const { return reciever_alive_.load(std::memory_order_acquire); }
+
+    void attach_sender() { senders_.fetch_add(1, std::memory_order_relaxed); }
+    void release_sender() {
+        if (senders_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            this->wake_reciever();
+        }
+    }
+    void release_reciever() { reciever_alive_.store(false, std::memory_order_release); }
+
+    // Closed from the receiving side, see basic_reciever::close. Only the reciever's thread calls this, the wake is for a parked receive
+    void close() {
+        this->release_reciever();
+        this->wake_reciever();
+    }
+
+    bool is_closed() const { return !this->has_sender() || !this->has_reciever(); }
+
+  private:
+    // AsOptional completes with std::optional<value_type> (receive) instead of Args... (resumption)
+    template <bool AsOptional = false, typename Self, typename Executor> bool complete_from_queue(Self &self, Executor &exec) {
+        // Pop before completing, the completion may resume the reciever inline and it may pop again
+        auto front_args_tuple = args_.try_pop();
+        if (!front_args_tuple) {
+            return false;
+        }
+        if constexpr (AsOptional) {
+            auto value = std::optional<value_type>(detail::value_from_tuple<value_type>(std::move(*front_args_tuple)));
+            detail::complete_from_tuple(self, exec, std::make_tuple(std::move(value)));
+        } else {
+            detail::complete_from_tuple(self, exec, std::move(*front_args_tuple));
+        }
+        return true;
+    }
+
+    // parked_ must be set
+    void park() {
+        waiting_.store(true, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // Re-check, a sender may have pushed (or the last one left) between the failed pop and raising waiting_
+        if ((!args_.empty() || this->is_closed()) && waiting_.exchange(false, std::memory_order_acq_rel)) {
+            parked_.wake(this->shared_from_this());
+        }
+    }
+
+    void wake_reciever() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_relaxed) && waiting_.exchange(false, std::memory_order_acq_rel)) {
+            parked_.wake(this->shared_from_this());
+        }
+    }
+
+    rebuild::mpsc_queue<args_type>                       args_;
+    detail::remote_parked                                parked_;
+    alignas(rebuild::cache_line_size) std::atomic<bool> waiting_{false};
+    std::atomic<std::size_t>                             senders_{0};
+    std::atomic<bool>                                    reciever_alive_{true};
+};
+
+/**
+ * Unbounded multi-producer/multi-consumer holder, senders and recievers are copyable and compete for the values in FIFO order.
+ *
+ * Values and parked recievers go into two intrusive MPSC queues. Matching them needs a single consumer for both queues, that role is
+ * handed around with a request counter instead of a lock: whoever bumps drain_requests_ from zero drains, everyone else only bumps the
+ * counter and leaves, and the drainer keeps going until it has accounted for every request. Nobody ever waits for another thread.
+ *
+ * The channel closes when every sender is gone or a reciever calls close(). Queued values are still handed out, after them every waiter
+ * gets the end of the stream as an empty optional from receive. A resumption cannot report it and is abandoned.
+ */
+template <typename... Args> struct mpmc_holder : std::enable_shared_from_this<mpmc_holder<Args...>> {
+    using ptr        = std::shared_ptr<mpmc_holder>;
+    using signature  = void(Args...);
+    using args_type  = std::tuple<Args...>;
+    using value_type = detail::batch_value<Args...>::type;
+
+    static auto make_holder() { return std::make_shared<mpmc_holder>(); }
+
+    ~mpmc_holder() {
+        if (next_waiter_) {
+            next_waiter_->abandon(next_waiter_);
+        }
+        while (auto *w = static_cast<waiter *>(waiters_.try_pop())) {
+            w->abandon(w);
+        }
+    }
+
+    // Asio entrypoint for async_compose. Will make the handle ready
+    template <typename Self, typename Executor>
+    [[nodiscard("always true, a closed channel abandons the operation instead")]] bool operator()(Self &&self, Executor &&exec) {
+        // Always parks, only the drainer may look at the queues. A resumption is abandoned once the channel is closed and the values are
+        // drained. Once parked, the reciever may be completed and destroyed on another thread before this call returns
+        auto keep_alive = this->shared_from_this();
+        waiters_.push(waiting_operation<std::decay_t<Self>, std::decay_t<Executor>, false>::make(std::move(self), exec));
+        this->drain();
+        return true;
+    }
+
+    // Asio entrypoint for receive. Completes with the next value, or with an empty optional once the channel is closed and drained
+    template <typename Self, typename Executor> void receive(Self &&self, Executor &&exec) {
+        auto keep_alive = this->shared_from_this();
+        waiters_.push(waiting_operation<std::decay_t<Self>, std::decay_t<Executor>, true>::make(std::move(self), exec));
+        this->drain();
+    }
+
+    // Any thread. Returns false if every reciever is gone
+    template <typename... U> bool send(U &&...args) { return this->try_send(std::forward<U>(args)...) == send_result::sent; }
+
+    // Unbounded, never reports send_result::full
+    template <typename... U> send_result try_send(U &&...args) {
+        if (!this->has_reciever() || closed_.load(std::memory_order_acquire)) {
+            return send_result::closed;
+        }
+        args_.emplace(std::forward<U>(args)...);
+        this->drain();
+        return send_result::sent;
+    }
+
+    bool has_sender() const { return senders_.load(std::memory_order_acquire) != 0; }
+    bool has_reciever() const { return recievers_.load(std::memory_order_acquire) != 0; }
+
+    void attach_sender() { senders_.fetch_add(1, std::memory_order_relaxed); }
+    void release_sender() {
+        if (senders_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            this->drain();
+        }
+    }
+    void attach_reciever() { recievers_.fetch_add(1, std::memory_order_relaxed); }
+    void release_reciever() { recievers_.fetch_sub(1, std::memory_order_acq_rel); }
+
+    // Any reciever, any thread. Sends report send_result::closed from now on, a send racing the close may still queue its value
+    void close() {
+        closed_.store(true, std::memory_order_release);
+        this->drain();
+    }
+
+    bool is_closed() const { return closed_.load(std::memory_order_acquire) || !this->has_sender() || !this->has_reciever(); }
+
+  private:
+    // A parked reciever, linked into waiters_ without a node of its own
+    struct waiter : rebuild::mpsc_node {
+        // Called once by the drainer, an empty optional means the channel is closed and the values are drained
+        void (*complete)(waiter *, std::optional<args_type>);
+        // Drops the operation without completing it, the holder is destroyed
+        void (*abandon)(waiter *);
+    };
+
+    // The operation is its own waiter, allocated with the handler's allocator (recycled by default) like detail::sleep_operation.
+    // AsOptional completes with std::optional<value_type> (receive) instead of Args... (resumption)
+    template <typename Self, typename Executor, bool AsOptional> class waiting_operation : public waiter {
+        using allocator_type = typename std::allocator_traits<decltype(detail::recycling_allocator_for(
+            std::declval<const Self &>()))>::template rebind_alloc<waiting_operation>;
+        using traits = std::allocator_traits<allocator_type>;
+
+      public:
+        static waiter *make(Self &&self, const Executor &exec) {
+            allocator_type allocator(detail::recycling_allocator_for(self));
+            auto          *op = traits::allocate(allocator, 1);
+            ::new (static_cast<void *>(op)) waiting_operation(std::move(self), exec, allocator);
+            return op;
+        }
+
+      private:
+        waiting_operation(Self &&self, const Executor &exec, const allocator_type &allocator)
+            : waiter{{}, &waiting_operation::completed, &waiting_operation::abandoned}, self_(std::move(self)), exec_(exec),
+              allocator_(allocator) {}
+
+        // Frees the operation first, the completion may park the next one in the same storage
+        std::pair<Self, Executor> release() {
+            std::pair<Self, Executor> taken(std::move(self_), std::move(exec_));
+            auto                      allocator = allocator_;
+            this->~waiting_operation();
+            traits::deallocate(allocator, this, 1);
+            return taken;
+        }
+
+        static void completed(waiter *w, std::optional<args_type> args) {
+            auto [self, exec] = static_cast<waiting_operation *>(w)->release();
+            asio::post(exec, [self = std::move(self), args = std::move(args)]() mutable {
+                if constexpr (AsOptional) {
+                    std::optional<value_type> value;
+                    if (args) {
+                        value.emplace(detail::value_from_tuple<value_type>(std::move(*args)));
+                    }
+                    self.complete(std::move(value));
+                } else if (args) {
+                    std::apply([&self](auto &&...unpacked_args) { self.complete(std::forward<decltype(unpacked_args)>(unpacked_args)...); },
+                               std::move(*args));
+                }
+                // else: the channel is closed, a resumption is abandoned like in holder
+            });
+        }
+
+        static void abandoned(waiter *w) { static_cast<waiting_operation *>(w)->release(); }
+
+        Self           self_;
+        Executor       exec_;
+        allocator_type allocator_;
+    };
+
+    void drain() {
+        if (drain_requests_.fetch_add(1, std::memory_order_acq_rel) != 0) {
+            // The current drainer will make another pass for us
+            return;
+        }
+        std::size_t requests = 1;
+        do {
+            this->match_waiters();
+            requests = drain_requests_.fetch_sub(requests, std::memory_order_acq_rel) - requests;
+        } while (requests != 0);
+    }
+
+    // Only called by the drainer, which is the single consumer of both queues
+    void match_waiters() {
+        for (;;) {
+            if (next_waiter_ == nullptr && (next_waiter_ = static_cast<waiter *>(waiters_.try_pop())) == nullptr) {
+                return;
+            }
+            auto front_args_tuple = args_.try_pop();
+            if (!front_args_tuple && !this->is_closed()) {
+                // Keep next_waiter_ for the pass triggered by the next send
+                return;
+            }
+            auto *w = std::exchange(next_waiter_, nullptr);
+            w->complete(w, std::move(front_args_tuple));
+        }
+    }
+
+    rebuild::mpsc_queue<args_type>                             args_;
+    rebuild::intrusive_mpsc_queue                              waiters_;
+    waiter                                                    *next_waiter_{nullptr};
+    alignas(rebuild::cache_line_size) std::atomic<std::size_t> drain_requests_{0};
+    std::atomic<std::size_t>                                   senders_{0};
+    std::atomic<std::size_t>                                   recievers_{0};
+    std::atomic<bool>                                          closed_{false};
+};
+
+template <typename... Args> using mpsc_sender   = basic_sender<mpsc_holder<Args...>>;
+template <typename... Args> using mpsc_reciever = basic_reciever<mpsc_holder<Args...>>;
+template <typename... Args> using mpmc_sender   = basic_sender<mpmc_holder<Args...>>;
+template <typename... Args> using mpmc_reciever = basic_reciever<mpmc_holder<Args...>>;
+
+template <typename... Args> auto make_mpsc_sender_reciever_pair() {
+    auto h = mpsc_holder<Args...>::make_holder();
+    return std::make_pair(mpsc_sender<Args...>(h), mpsc_reciever<Args...>(h));
+}
+
+template <typename... Args> auto make_mpmc_sender_reciever_pair() {
+    auto h = mpmc_holder<Args...>::make_holder();
+    return std::make_pair(mpmc_sender<Args...>(h), mpmc_reciever<Args...>(h));
+}
+
+} // namespace rebuild::async
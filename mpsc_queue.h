@@ -0,0 +1,113 @@
+#pragma once
+
+#include <infrastructure/cache_line.h>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace rebuild {
+
+// Intrusive hook, derive from it to make a type pushable into an intrusive_mpsc_queue
+struct mpsc_node {
+    std::atomic<mpsc_node *> next_{nullptr};
+};
+
+/**
+ * Intrusive, unbounded multi-producer/single-consumer queue (Dmitry Vyukov's algorithm).
+ *
+ * push is wait-free (one exchange and one store), try_pop is lock-free and must only be called by one thread at a time. The queue does
+ * not own the nodes. Between the exchange and the link store of a push the queue is briefly "in flux": try_pop may then return nullptr
+ * even though nodes were pushed, the pushing thread will observe the node as linked once its push returns.
+ */
+class intrusive_mpsc_queue {
+  public:
+    intrusive_mpsc_queue() = default;
+
+    intrusive_mpsc_queue(const intrusive_mpsc_queue &)            = delete;
+    intrusive_mpsc_queue &operator=(const intrusive_mpsc_queue &) = delete;
+
+    // Producer side, any thread
+    void push(mpsc_node *node) {
+        node->next_.store(nullptr, std::memory_order_relaxed);
+        auto *prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next_.store(node, std::memory_order_release);
+    }
+
+    // Consumer side
+    mpsc_node *try_pop() {
+        auto *tail = tail_;
+        auto *next = tail->next_.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (next == nullptr) {
+                return nullptr;
+            }
+            tail_ = next;
+            tail  = next;
+            next  = next->next_.load(std::memory_order_acquire);
+        }
+        if (next != nullptr) {
+            tail_ = next;
+            return tail;
+        }
+        if (tail != head_.load(std::memory_order_acquire)) {
+            // A producer has exchanged head_ but not linked its node yet
+            return nullptr;
+        }
+        this->push(&stub_);
+        next = tail->next_.load(std::memory_order_acquire);
+        if (next != nullptr) {
+            tail_ = next;
+            return tail;
+        }
+        return nullptr;
+    }
+
+    // Consumer side
+    bool empty() const { return tail_ == &stub_ && stub_.next_.load(std::memory_order_acquire) == nullptr; }
+
+  private:
+    alignas(cache_line_size) std::atomic<mpsc_node *> head_{&stub_};
+    alignas(cache_line_size) mpsc_node *tail_{&stub_};
+    mpsc_node stub_;
+};
+
+// Value owning multi-producer/single-consumer queue on top of intrusive_mpsc_queue, one node allocation per element
+template <typename T> class mpsc_queue {
+  public:
+    mpsc_queue() = default;
+
+    ~mpsc_queue() {
+        while (try_pop()) {
+        }
+    }
+
+    mpsc_queue(const mpsc_queue &)            = delete;
+    mpsc_queue &operator=(const mpsc_queue &) = delete;
+
+    // Producer side, any thread
+    template <typename... U> void emplace(U &&...args) { queue_.push(new node(std::forward<U>(args)...)); }
+
+    // Consumer side
+    std::optional<T> try_pop() {
+        std::unique_ptr<node> front(static_cast<node *>(queue_.try_pop()));
+        if (!front) {
+            return std::nullopt;
+        }
+        return std::optional<T>(std::move(front->value));
+    }
+
+    // Consumer side
+    bool empty() const { return queue_.empty(); }
+
+  private:
+    struct node : mpsc_node {
+        template <typename... U> explicit node(U &&...args) : value(std::forward<U>(args)...) {}
+        T value;
+    };
+
+    intrusive_mpsc_queue queue_;
+};
+
+} // namespace rebuild
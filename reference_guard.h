@@ -1,5 +1,102 @@
 #pragma once
+#include <infrastructure/cache_line.h>
+
+#include <array>
 #include <atomic>
+#include <cstddef>
+
+/**
+ * Counter policies for reference_guard.
+ *
+ * acquire() counts a new reference and returns a token saying where it was
+ * counted. A moved reference is counted again with the token of its source, and
+ * release(token) undoes one count, so a counter can only reach zero when no
+ * reference counted on it is left. wait_zero() blocks until every counter is
+ * zero.
+ */
+
+// One atomic counter, the cheapest choice when few threads make references
+class single_counter {
+public:
+  struct token {};
+
+  token acquire() noexcept { return acquire(token{}); }
+  token acquire(token t) noexcept {
+    counter_.fetch_add(1, std::memory_order_relaxed);
+    return t;
+  }
+
+  void release(token) noexcept {
+    // Ensures operations inside the reference are properly synchronized, same
+    // as std::shared_ptr destructor
+    if (counter_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      // Only notify if there's a chance that this was the last reference
+      counter_.notify_one();
+    }
+  }
+
+  void wait_zero() noexcept { wait_zero(counter_); }
+
+  // Shared with striped_counter
+  static void wait_zero(std::atomic<std::size_t> &counter) noexcept {
+    auto count = counter.load(std::memory_order_acquire);
+    while (count > 0) {
+      counter.wait(count, std::memory_order_acquire);
+      count = counter.load(std::memory_order_acquire);
+    }
+  }
+
+private:
+  std::atomic<std::size_t> counter_{0};
+};
+
+// Stripes counters over separate cache lines, each thread counts its new
+// references on its own stripe. Use when many threads (e.g. every io_context
+// thread) make references to the same guard, so they stop bouncing one cache
+// line between cores. The destructor sums up by waiting on every stripe.
+template <std::size_t Stripes = 16> class striped_counter {
+  static_assert(Stripes > 0);
+
+public:
+  struct token {
+    std::size_t stripe;
+  };
+
+  token acquire() noexcept { return acquire(token{this_thread_stripe()}); }
+  token acquire(token t) noexcept {
+    stripes_[t.stripe].count.fetch_add(1, std::memory_order_relaxed);
+    return t;
+  }
+
+  void release(token t) noexcept {
+    auto &count = stripes_[t.stripe].count;
+    if (count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      count.notify_one();
+    }
+  }
+
+  void wait_zero() noexcept {
+    // A stripe seen at zero stays there, only make_reference (not called any
+    // more) or a move of a reference on that same stripe could raise it
+    for (auto &stripe : stripes_) {
+      single_counter::wait_zero(stripe.count);
+    }
+  }
+
+private:
+  struct alignas(rebuild::cache_line_size) stripe {
+    std::atomic<std::size_t> count{0};
+  };
+
+  static std::size_t this_thread_stripe() noexcept {
+    static std::atomic<std::size_t> next_thread{0};
+    thread_local const std::size_t index =
+        next_thread.fetch_add(1, std::memory_order_relaxed) % Stripes;
+    return index;
+  }
+
+  std::array<stripe, Stripes> stripes_;
+};
 
 /**
  * Thread-safe, lock-free reference_guard management for any object's references
@@ -26,45 +123,28 @@
  *
  * This is an ad hoc solution to fixing stack allocated reference_guard issues.
  * For more general problems use shared/weak ptr.
+ *
+ * Counter selects how references are counted, single_counter (default) or
+ * striped_counter<N> when many threads make references concurrently.
  */
-template <typename T> class reference_guard {
+template <typename T, typename Counter = single_counter> class reference_guard {
 public:
   explicit constexpr reference_guard(T &object)
-      : object_{object}, counter_(0), alive_(true) {}
+      : object_{object}, alive_(true) {}
   constexpr ~reference_guard() {
     alive_.store(false, std::memory_order_release);
     alive_.notify_all();
 
-    // Synchronize 1st load, to avoid any potential wait
-    auto count = counter_.load(std::memory_order_acquire);
-    auto has_references = [](auto count) {
-      return count > static_cast<decltype(count)>(0);
-    };
-
-    while (has_references(count)) {
-      // Following loads can be relaxed. Sync already ensured by notify_one()
-      counter_.wait(count, std::memory_order_relaxed);
-      count = counter_.load(std::memory_order_relaxed);
-    }
+    counter_.wait_zero();
   }
   class reference {
   public:
-    explicit constexpr reference(reference_guard &g) : guard_(g) {
-      guard_.counter_.fetch_add(1, std::memory_order_relaxed);
-    }
-    constexpr reference(reference &&other) noexcept : guard_(other.guard_) {
-      guard_.counter_.fetch_add(1, std::memory_order_relaxed);
-    }
+    explicit constexpr reference(reference_guard &g)
+        : guard_(g), token_(guard_.counter_.acquire()) {}
+    constexpr reference(reference &&other) noexcept
+        : guard_(other.guard_), token_(guard_.counter_.acquire(other.token_)) {}
 
-    constexpr ~reference() {
-      // Ensures operations inside the reference are properly synchronized, same
-      // as std::shared_ptr destructor
-      auto count = guard_.counter_.fetch_sub(1, std::memory_order_acq_rel);
-      if (count == 1) {
-        // Only notify if there's a chance that this was the last reference
-        guard_.counter_.notify_one();
-      }
-    }
+    constexpr ~reference() { guard_.counter_.release(token_); }
 
     T &get() { return guard_.object_; }
     bool alive() const { return guard_.alive_.load(std::memory_order_acquire); }
@@ -78,19 +158,22 @@ public:
     constexpr reference &operator=(const reference &) noexcept = delete;
 
   private:
-    reference_guard<T> &guard_;
+    reference_guard &guard_;
+    [[no_unique_address]] typename Counter::token token_;
   };
 
   constexpr auto make_reference() { return reference(*this); }
 
 private:
   T &object_;
-  std::atomic<std::size_t> counter_;
+  Counter counter_;
   std::atomic<bool> alive_;
 };
 
-template <typename T> using reference = reference_guard<T>::reference;
-template <typename T> class reference_guarded {
+template <typename T, typename Counter = single_counter>
+using reference = reference_guard<T, Counter>::reference;
+template <typename T, typename Counter = single_counter>
+class reference_guarded {
 public:
   explicit constexpr reference_guarded() : guard_(t_) {}
 
@@ -98,5 +181,5 @@ public:
 
 private:
   T t_;
-  reference_guard<T> guard_;
+  reference_guard<T, Counter> guard_;
 };
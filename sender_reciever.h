@@ -1,18 +1,48 @@
 #pragma once
 #ifdef ASIO_STANDALONE
 #include <asio/as_tuple.hpp>
+#include <asio/any_io_executor.hpp>
+#include <asio/associated_allocator.hpp>
+#include <asio/associated_executor.hpp>
+#include <asio/cancellation_type.hpp>
 #include <asio/compose.hpp>
+#include <asio/dispatch.hpp>
+#include <asio/error.hpp>
+#include <asio/post.hpp>
+#include <asio/recycling_allocator.hpp>
+#include <asio/system_error.hpp>
 #include <asio/use_awaitable.hpp>
 #else
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/cancellation_type.hpp>
 #include <boost/asio/compose.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/recycling_allocator.hpp>
 #endif
+#include <async/timer_wheel.h>
+#include <cassert>
+#include <chrono>
+#include <deque>
 #include <infrastructure/move_only_function.h>
+#include <limits>
 #include <memory>
+#include <new>
+#include <optional>
 #include <queue>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <tuple>
 #include <utility>
+#include <variant>
 
 namespace rebuild::async {
 
+// Completes with the Args of the next send. void(Args...) has nothing else to complete with: it throws on a closed and drained channel,
+// drops a wait that is parked when the channel closes and ignores cancellation. awaitable_resumption reports a cancellation, receive
+// reports both
 template <typename Resumption, typename CompletionToken, typename Executor>
 auto resumption(Resumption &r, CompletionToken &&token, Executor &&exec) {
     return asio::async_compose<CompletionToken, typename Resumption::signature>(
@@ -25,86 +55,821 @@ auto resumption(Resumption &r, CompletionToken &&token, Executor &&exec) {
         token, exec);
 }
 
-template <typename... Args> struct sender;
-template <typename... Args> struct reciever;
+// Completes with void(std::optional<value_type>), empty once the channel is closed (by either end, see close()) and drained. Unlike
+// resumption, which throws on a closed channel and drops a wait parked when it closes, the end of the stream is a value
+template <typename Resumption, typename CompletionToken, typename Executor>
+auto receive(Resumption &r, CompletionToken &&token, Executor &&exec) {
+    return asio::async_compose<CompletionToken, void(std::optional<typename Resumption::value_type>)>(
+        [&r, &exec]<typename Self>(Self &&self) { r.receive(std::forward<Self>(self), std::forward<Executor>(exec)); }, token, exec);
+}
+
+// Fills out with up to out.size() values in one completion, void(std::size_t) with the number of values written. 0 for a non-empty out
+// means the channel is closed and drained
+template <typename Resumption, typename CompletionToken, typename Executor>
+auto receive_batch(Resumption &r, std::span<typename Resumption::value_type> out, CompletionToken &&token, Executor &&exec) {
+    return asio::async_compose<CompletionToken, void(std::size_t)>(
+        [&r, out, &exec]<typename Self>(Self &&self) {
+            auto can_complete = r.receive_batch(std::forward<Self>(self), std::forward<Executor>(exec), out);
+            if (!can_complete) {
+                throw std::runtime_error("No sender or queue empty");
+            }
+        },
+        token, exec);
+}
+
+// Completes with void(std::optional<value_type>), empty if nothing arrived before the deadline, the channel is closed and drained (tell
+// them apart with is_closed()) or the receive was cancelled. No timer object per call, the deadline goes into the timer_wheel of exec.
+// The deadline expires on exec and withdraws the parked receive from the channel, so exec must be the thread's or strand's executor the
+// channel is used from, not a plain io_context executor that several threads run
+template <typename Resumption, typename CompletionToken, typename Executor>
+auto receive_until(Resumption &r, timer_wheel::time_point deadline, CompletionToken &&token, Executor &&exec) {
+    return asio::async_compose<CompletionToken, void(std::optional<typename Resumption::value_type>)>(
+        [&r, deadline, &exec]<typename Self>(Self &&self) {
+            auto can_complete = r.receive_until(std::forward<Self>(self), std::forward<Executor>(exec), deadline);
+            if (!can_complete) {
+                throw std::runtime_error("No sender or queue empty");
+            }
+        },
+        token, exec);
+}
+
+template <typename Resumption, typename Rep, typename Period, typename CompletionToken, typename Executor>
+auto receive_for(Resumption &r, std::chrono::duration<Rep, Period> timeout, CompletionToken &&token, Executor &&exec) {
+    return receive_until(r, timer_wheel::clock::now() + std::chrono::ceil<timer_wheel::clock::duration>(timeout),
+                         std::forward<CompletionToken>(token), std::forward<Executor>(exec));
+}
+
+namespace detail {
+// A batch element is the value itself for single argument channels and the whole tuple otherwise
+template <typename... Args> struct batch_value {
+    using type = std::tuple<Args...>;
+};
+template <typename Arg> struct batch_value<Arg> {
+    using type = Arg;
+};
+
+template <typename Value, typename Tuple> Value value_from_tuple(Tuple &&args) {
+    if constexpr (std::is_same_v<Value, std::remove_cvref_t<Tuple>>) {
+        return std::forward<Tuple>(args);
+    } else {
+        return std::get<0>(std::forward<Tuple>(args));
+    }
+}
+
+// One-shot, move-only void() callable for parking a completion handler. The storage comes from the handler's associated allocator, the
+// holders pass their parking_slot for plain handlers, so a steady stream of park -> wake reuses the same memory instead of hitting the
+// heap on every message.
+class parked_completion {
+  public:
+    parked_completion() noexcept = default;
+    parked_completion(std::nullptr_t) noexcept {}
+
+    template <typename F, typename Allocator> parked_completion(F &&f, const Allocator &allocator) {
+        using impl_type      = impl<std::decay_t<F>, Allocator>;
+        using impl_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<impl_type>;
+        using traits         = std::allocator_traits<impl_allocator>;
+
+        impl_allocator a(allocator);
+        auto          *storage = traits::allocate(a, 1);
+        try {
+            ptr_ = ::new (static_cast<void *>(storage)) impl_type(std::forward<F>(f), allocator);
+        } catch (...) {
+            traits::deallocate(a, storage, 1);
+            throw;
+        }
+    }
+
+    parked_completion(parked_completion &&other) noexcept : ptr_(std::exchange(other.ptr_, nullptr)) {}
+    parked_completion &operator=(parked_completion &&other) noexcept {
+        if (this != &other) {
+            this->reset();
+            ptr_ = std::exchange(other.ptr_, nullptr);
+        }
+        return *this;
+    }
+    parked_completion &operator=(std::nullptr_t) noexcept {
+        this->reset();
+        return *this;
+    }
+    ~parked_completion() { this->reset(); }
+
+    // Leaves this empty, the storage is released before the callable runs
+    void operator()() {
+        assert(ptr_ && "parked completion is empty");
+        std::exchange(ptr_, nullptr)->invoke_and_destroy();
+    }
+
+    explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+  private:
+    struct base {
+        virtual void invoke_and_destroy() = 0;
+        virtual void destroy() noexcept   = 0;
 
-template <typename... Args> struct holder {
-    using ptr       = std::shared_ptr<holder>;
-    using signature = void(Args...);
+      protected:
+        ~base() = default;
+    };
+
+    template <typename F, typename Allocator> struct impl final : base {
+        using impl_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<impl>;
+
+        template <typename G> impl(G &&g, const Allocator &allocator) : f_(std::forward<G>(g)), allocator_(allocator) {}
+
+        void invoke_and_destroy() override {
+            F f(std::move(f_));
+            this->destroy();
+            f();
+        }
+
+        void destroy() noexcept override {
+            impl_allocator a(allocator_);
+            this->~impl();
+            std::allocator_traits<impl_allocator>::deallocate(a, this, 1);
+        }
+
+        F         f_;
+        Allocator allocator_;
+    };
+
+    void reset() noexcept {
+        if (ptr_) {
+            std::exchange(ptr_, nullptr)->destroy();
+        }
+    }
+
+    base *ptr_{nullptr};
+};
+
+template <typename Handler> auto recycling_allocator_for(const Handler &handler) {
+    auto allocator = asio::get_associated_allocator(handler, asio::recycling_allocator<void>());
+    // std::allocator states no preference, older asio reports it for every composed operation. Recycle instead
+    if constexpr (std::is_same_v<decltype(allocator), std::allocator<void>>) {
+        return asio::recycling_allocator<void>();
+    } else {
+        return allocator;
+    }
+}
+
+// Storage for the one completion a holder has parked at a time. A parked_completion releases its block before it runs, the slot keeps it
+// and the next park takes it back, so a steady stream of messages does not allocate. asio's thread local cache alone does not give that,
+// it has a single block per thread that whatever else completes on the thread may take first. Not thread safe, park and release must be
+// sequenced like the rest of the holder's state
+class parking_slot {
+  public:
+    parking_slot() = default;
+    ~parking_slot() { ::operator delete(block_); }
+
+    parking_slot(const parking_slot &)            = delete;
+    parking_slot &operator=(const parking_slot &) = delete;
+
+    void *allocate(std::size_t size) {
+        if (block_ && size <= size_) {
+            return std::exchange(block_, nullptr);
+        }
+        return ::operator new(size);
+    }
+
+    void deallocate(void *block, std::size_t size) noexcept {
+        if (block_ && size <= size_) {
+            ::operator delete(block);
+            return;
+        }
+        ::operator delete(std::exchange(block_, block));
+        size_ = size;
+    }
+
+  private:
+    void       *block_{nullptr};
+    std::size_t size_{0};
+};
+
+template <typename T> class slot_allocator {
+  public:
+    using value_type = T;
+
+    explicit slot_allocator(parking_slot &slot) noexcept : slot_(&slot) {}
+    template <typename U> slot_allocator(const slot_allocator<U> &other) noexcept : slot_(other.slot_) {}
+
+    T *allocate(std::size_t n) {
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        } else {
+            return static_cast<T *>(slot_->allocate(n * sizeof(T)));
+        }
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept {
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(p, std::align_val_t(alignof(T)));
+        } else {
+            slot_->deallocate(p, n * sizeof(T));
+        }
+    }
+
+    template <typename U> bool operator==(const slot_allocator<U> &other) const noexcept { return slot_ == other.slot_; }
+
+  private:
+    template <typename> friend class slot_allocator;
+
+    parking_slot *slot_;
+};
+
+// The slot stands in for the default (recycling) allocator, a handler that brings an allocator of its own keeps it
+template <typename Allocator> auto parking_allocator(parking_slot &slot, const Allocator &allocator) {
+    if constexpr (std::is_same_v<Allocator, asio::recycling_allocator<void>>) {
+        return slot_allocator<void>(slot);
+    } else {
+        return allocator;
+    }
+}
+
+// A parked handler moves only executors, work guards and pointers, but asio does not mark e.g. composed_op's move constructor noexcept.
+// Inline storage (inplace_function) needs a noexcept move, this wrapper states it for the handler
+template <typename F> class nothrow_movable {
+  public:
+    explicit nothrow_movable(F &&f) : f_(std::move(f)) {}
+    nothrow_movable(nothrow_movable &&other) noexcept : f_(std::move(other.f_)) {}
+
+    decltype(auto) operator()() { return f_(); }
+
+  private:
+    F f_;
+};
+
+// parked_completion takes its storage from the handler's allocator, any other completion type (e.g. an inplace_function) is built as is
+template <typename Completion, typename F, typename Allocator> Completion make_completion(F &&f, const Allocator &allocator) {
+    if constexpr (std::is_constructible_v<Completion, F, const Allocator &>) {
+        return Completion(std::forward<F>(f), allocator);
+    } else if constexpr (std::is_nothrow_move_constructible_v<std::decay_t<F>>) {
+        return Completion(std::forward<F>(f));
+    } else {
+        return Completion(nothrow_movable<std::decay_t<F>>(std::decay_t<F>(std::forward<F>(f))));
+    }
+}
+
+// A completion parked by the reciever and woken from any thread (spsc/mpsc holders). The waking thread only posts a small handler to the
+// reciever's executor, the parked completion runs and is released there, so its storage goes back to the slot on the reciever's side
+// before the reciever can park again. A wake from a thread outside the io_context still allocates asio's post operation.
+class remote_parked {
+  public:
+    // The reciever's thread. F is called with the operation, on the operation's associated executor
+    template <typename Self, typename F> void park(Self &&self, F &&f) {
+        auto allocator = parking_allocator(slot_, recycling_allocator_for(self));
+        exec_          = asio::get_associated_executor(self);
+        completion_    = parked_completion(
+            [self = std::move(self) /* must be moved, deferred complete */, f = std::forward<F>(f)]() mutable { f(self); }, allocator);
+    }
+
+    // Any thread, once per park. keep_alive owns the object holding this
+    template <typename KeepAlive> void wake(KeepAlive keep_alive) {
+        // Copy first, the reciever may park again (and assign exec_) as soon as the post is queued
+        auto exec = exec_;
+        asio::post(exec, [this, keep_alive = std::move(keep_alive)] { std::exchange(completion_, nullptr)(); });
+    }
+
+  private:
+    parking_slot          slot_; // outlives completion_
+    parked_completion     completion_;
+    asio::any_io_executor exec_;
+};
+
+// Completing from inside the initiating call resumes the reciever on the current stack, and it may immediately recieve again from a
+// non-empty queue. Bound that recursion and post the completion once the bound is hit.
+inline thread_local std::size_t inline_completion_depth     = 0;
+inline constexpr std::size_t    max_inline_completion_depth = 16;
+
+struct inline_completion_scope {
+    inline_completion_scope() { ++inline_completion_depth; }
+    ~inline_completion_scope() { --inline_completion_depth; }
+
+    inline_completion_scope(const inline_completion_scope &)            = delete;
+    inline_completion_scope &operator=(const inline_completion_scope &) = delete;
+};
+
+template <typename Self, typename Executor, typename Tuple> void complete_from_tuple(Self &self, Executor &&exec, Tuple &&args) {
+    if (inline_completion_depth < max_inline_completion_depth) {
+        inline_completion_scope scope;
+        std::apply([&self](auto &&...unpacked_args) { std::move(self).complete(std::forward<decltype(unpacked_args)>(unpacked_args)...); },
+                   std::forward<Tuple>(args));
+    } else {
+        asio::post(exec, [self = std::move(self), args = std::forward<Tuple>(args)]() mutable {
+            std::apply([&self](auto &&...unpacked_args) { self.complete(std::forward<decltype(unpacked_args)>(unpacked_args)...); },
+                       std::move(args));
+        });
+    }
+}
+} // namespace detail
+
+// How a send wakes a parked reciever. post always goes through the executor queue. direct resumes the reciever inside the send when the
+// sender is already running on the reciever's executor (asio::dispatch), falling back to post past max_inline_completion_depth
+enum class handoff { post, direct };
+
+namespace detail {
+template <typename Executor, typename Function> void wake(handoff mode, Executor &exec, Function &&f) {
+    if (mode == handoff::direct && inline_completion_depth < max_inline_completion_depth) {
+        asio::dispatch(exec, [f = std::forward<Function>(f)]() mutable {
+            inline_completion_scope scope;
+            f();
+        });
+    } else {
+        asio::post(exec, std::forward<Function>(f));
+    }
+}
+
+// A cancelled wait completes from inside the cancellation slot's handler, which must not be cleared from there, so the completion is
+// posted like sleep_operation::abort does
+template <typename Self, typename Executor, typename... Results> void post_cancelled(Self &self, Executor &exec, Results &&...results) {
+    asio::post(exec, [self = std::move(self), results = std::make_tuple(std::forward<Results>(results)...)]() mutable {
+        clear_cancellation(self);
+        std::apply([&self](auto &&...unpacked) { self.complete(std::forward<decltype(unpacked)>(unpacked)...); }, std::move(results));
+    });
+}
+} // namespace detail
+
+namespace detail {
+// One timed receive, owned by the completion parked in the holder. Whichever comes first, a value or the deadline, completes it and takes
+// the other out: a value unlinks the wheel entry, the deadline withdraws the parked completion
+template <typename Holder, typename Self, typename Executor>
+struct timed_receive : timer_wheel::entry, std::enable_shared_from_this<timed_receive<Holder, Self, Executor>> {
+    using value_type = typename Holder::value_type;
+
+    timed_receive(Holder &holder, Self self, Executor exec, std::shared_ptr<timer_wheel> wheel)
+        : timer_wheel::entry{&timed_receive::expired}, holder_(holder), self_(std::move(self)), exec_(std::move(exec)),
+          wheel_(std::move(wheel)) {}
+
+    // Also reached when the parked completion is dropped (a holder destroyed while parked), the wheel must not expire a destroyed entry
+    ~timed_receive() {
+        if (wheel_->cancel(*this)) {
+            wheel_->disarm_if_idle();
+        }
+    }
+
+    void received(typename Holder::args_type &&args) {
+        wheel_->cancel(*this);
+        this->complete(std::optional<value_type>(value_from_tuple<value_type>(std::move(args))));
+    }
+
+    void closed() {
+        wheel_->cancel(*this);
+        this->complete(std::nullopt);
+    }
+
+    // Runs inside the cancellation slot's handler, so the completion is always posted, see post_cancelled
+    void cancelled() {
+        wheel_->cancel(*this);
+        asio::post(exec_, [self = std::move(self_), wheel = wheel_]() mutable {
+            clear_cancellation(self);
+            self.complete(std::optional<value_type>());
+            wheel->disarm_if_idle();
+        });
+    }
+
+    static void expired(timer_wheel::entry *e) {
+        auto *self = static_cast<timed_receive *>(e);
+        // The parked completion holds the last reference to this
+        auto keep = self->shared_from_this();
+        self->holder_.cancel_wait();
+        self->complete(std::nullopt);
+    }
+
+    void complete(std::optional<value_type> value) {
+        wake(holder_.handoff_mode(), exec_, [self = std::move(self_), value = std::move(value), wheel = wheel_]() mutable {
+            clear_cancellation(self);
+            self.complete(std::move(value));
+            wheel->disarm_if_idle();
+        });
+    }
+
+    Holder                      &holder_;
+    Self                         self_;
+    Executor                     exec_;
+    std::shared_ptr<timer_wheel> wheel_;
+};
+} // namespace detail
+
+template <typename Holder> struct basic_sender;
+template <typename Holder> struct basic_reciever;
+
+// Capacity of a channel that never reports full. A capacity of 0 only hands values to a reciever that is already waiting
+inline constexpr std::size_t unbounded = std::numeric_limits<std::size_t>::max();
+
+enum class send_result { sent, full, closed };
+
+// Holders that count their senders/recievers allow the front ends to be copied (fan-in and competing recievers)
+template <typename Holder>
+concept multi_producer_holder = requires(Holder &h) { h.attach_sender(); };
+
+template <typename Holder>
+concept multi_consumer_holder = requires(Holder &h) { h.attach_reciever(); };
+
+// Holders that can be waited on together with others, see receive_any
+template <typename Holder>
+concept selectable_holder = requires(Holder &h) {
+    h.try_receive();
+    h.cancel_wait();
+    h.handoff_mode();
+};
+
+// Single threaded holder, the sender and the reciever must be used from the same thread (or strand).
+// A holder is the shared state between a basic_sender and a basic_reciever, any type with the same members can be used as Holder.
+// Completion stores the parked reciever, a one-shot void() callable. Use e.g. rebuild::inplace_function<void(), N> to guarantee that
+// parking never allocates, an oversized completion handler is then a compile error.
+template <typename Completion, typename... Args> struct basic_holder : std::enable_shared_from_this<basic_holder<Completion, Args...>> {
+    using ptr        = std::shared_ptr<basic_holder>;
+    using signature  = void(Args...);
+    using args_type  = std::tuple<Args...>;
+    using value_type = detail::batch_value<Args...>::type;
+
+    explicit basic_holder(std::size_t capacity = unbounded, handoff mode = handoff::post) : capacity_(capacity), handoff_(mode) {}
+
+    static auto make_holder(std::size_t capacity = unbounded, handoff mode = handoff::post) {
+        return std::make_shared<basic_holder>(capacity, mode);
+    }
 
     // Asio entrypoint for async_compose. Will make the handle ready
     template <typename Self, typename Executor>
     [[nodiscard("if false, then the sender is gone AND the queue empty")]] bool operator()(Self &&self, Executor &&exec) {
 
         // These two if-statements below do "self.complete(Args...)", one is resolved immediately, the other is posted
-        if (!args_.empty()) /* resumption already available, complete immediately  */ {
-            auto front_args_tuple = std::move(args_.front());
-            args_.pop();
-            std::apply([&self /* completed here, so we can capture by ref */](
-                           Args &&...unpacked_args) mutable { std::forward<Self>(self).complete(std::forward<Args>(unpacked_args)...); },
-                       std::move(front_args_tuple));
+        if (auto front_args_tuple = this->pop_front()) /* resumption already available, complete immediately  */ {
+            detail::complete_from_tuple(self, exec, std::move(*front_args_tuple));
             return true;
-        } else if (this->has_active_sender()) {
-            f_ = [self = std::move(self) /* must be moved, deferred complete */, exec](Args &&...args) mutable {
-                asio::post(exec, [self = std::move(self), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
-                    std::apply([&self](auto &&...captured_args) { self.complete(std::forward<decltype(captured_args)>(captured_args)...); },
-                               std::move(args));
-                });
-            };
+        } else if (this->has_sender()) {
+            // The value is left in pending_ by the sender, neither the parked handler nor the posted completion carries a copy of it.
+            // void(Args...) cannot report a cancellation, so no slot handler is installed, see awaitable_resumption
+            auto allocator = detail::parking_allocator(slot_, detail::recycling_allocator_for(self));
+            f_             = detail::make_completion<Completion>(
+                [this, self = std::move(self) /* must be moved, deferred complete */, exec]() mutable {
+                    if (!pending_) {
+                        // Closed while parked, void(Args...) has no way to report the end of the stream and the handler is dropped
+                        return;
+                    }
+                    detail::wake(handoff_, exec, [this, self = std::move(self)]() mutable {
+                        std::apply(
+                            [&self](auto &&...pending_args) { self.complete(std::forward<decltype(pending_args)>(pending_args)...); },
+                            this->take_pending());
+                    });
+                },
+                allocator);
             return true;
         }
 
         return false;
     }
 
+    // Asio entrypoint for receive. Completes with the next value, or with an empty optional once the channel is closed and drained
+    template <typename Self, typename Executor> void receive(Self &&self, Executor &&exec) {
+        if (auto front_args_tuple = this->pop_front()) {
+            auto value = std::optional<value_type>(detail::value_from_tuple<value_type>(std::move(*front_args_tuple)));
+            detail::complete_from_tuple(self, exec, std::make_tuple(std::move(value)));
+        } else if (this->is_closed()) {
+            detail::complete_from_tuple(self, exec, std::make_tuple(std::optional<value_type>()));
+        } else {
+            auto allocator = detail::parking_allocator(slot_, detail::recycling_allocator_for(self));
+            this->cancel_on_signal(self);
+            f_ = detail::make_completion<Completion>(
+                [this, self = std::move(self) /* must be moved, deferred complete */, exec]() mutable {
+                    if (cancelling_) {
+                        detail::post_cancelled(self, exec, std::optional<value_type>());
+                        return;
+                    }
+                    detail::wake(handoff_, exec, [this, self = std::move(self)]() mutable {
+                        detail::clear_cancellation(self);
+                        // Nothing pending means the channel was closed while parked, nothing can be sent to it anymore
+                        std::optional<value_type> value;
+                        if (pending_) {
+                            value.emplace(detail::value_from_tuple<value_type>(this->take_pending()));
+                        }
+                        self.complete(std::move(value));
+                    });
+                },
+                allocator);
+        }
+    }
+
+    // Asio entrypoint for receive_batch. Drains what is queued, or parks until the next send and then takes everything queued up to the
+    // point the completion runs, so a burst of sends costs a single resumption. Completes with 0 once the channel is closed and drained
+    template <typename Self, typename Executor>
+    [[nodiscard("if false, then the sender is gone AND the queue empty")]] bool receive_batch(Self &&self, Executor &&exec,
+                                                                                              std::span<value_type> out) {
+        if (auto n = this->drain_into(out); n > 0 || out.empty() || this->is_closed()) {
+            detail::complete_from_tuple(self, exec, std::make_tuple(n));
+            return true;
+        }
+
+        auto allocator = detail::parking_allocator(slot_, detail::recycling_allocator_for(self));
+        this->cancel_on_signal(self);
+        f_ = detail::make_completion<Completion>(
+            [this, self = std::move(self) /* must be moved, deferred complete */, exec, out]() mutable {
+                if (cancelling_) {
+                    detail::post_cancelled(self, exec, std::size_t{0});
+                    return;
+                }
+                detail::wake(handoff_, exec, [this, self = std::move(self), out]() mutable {
+                    detail::clear_cancellation(self);
+                    if (!pending_) {
+                        self.complete(std::size_t{0});
+                        return;
+                    }
+                    out.front() = detail::value_from_tuple<value_type>(this->take_pending());
+                    self.complete(1 + this->drain_into(out.subspan(1)));
+                });
+            },
+            allocator);
+        return true;
+    }
+
+    // Asio entrypoint for receive_until. Completes with the next value, or with an empty optional once the deadline has passed. The
+    // deadline is an entry in the executor's timer_wheel, allocated together with the parked handler
+    template <typename Self, typename Executor>
+    [[nodiscard("if false, then the sender is gone AND the queue empty")]] bool receive_until(Self &&self, Executor &&exec,
+                                                                                              timer_wheel::time_point deadline) {
+        if (auto front_args_tuple = this->pop_front()) {
+            auto value = std::optional<value_type>(detail::value_from_tuple<value_type>(std::move(*front_args_tuple)));
+            detail::complete_from_tuple(self, exec, std::make_tuple(std::move(value)));
+            return true;
+        } else if (this->is_closed() || deadline <= timer_wheel::clock::now()) {
+            detail::complete_from_tuple(self, exec, std::make_tuple(std::optional<value_type>()));
+            return true;
+        }
+
+        using state_type = detail::timed_receive<basic_holder, std::decay_t<Self>, std::decay_t<Executor>>;
+        auto allocator   = detail::recycling_allocator_for(self);
+        this->cancel_on_signal(self);
+        auto state = std::allocate_shared<state_type>(allocator, *this, std::move(self), exec, timer_wheel::for_executor(exec));
+        f_         = detail::make_completion<Completion>(
+            [this, state]() {
+                if (cancelling_) {
+                    state->cancelled();
+                } else if (pending_) {
+                    state->received(this->take_pending());
+                } else {
+                    state->closed();
+                }
+            },
+            allocator);
+        state->wheel_->insert(*state, deadline);
+        return true;
+    }
+
+    // Select support, see receive_any. Takes a queued value, never parks
+    std::optional<args_type> try_receive() { return this->pop_front(); }
+
+    // Select support. Parks on_send, which is called with the value inside the send that hands it over (not from the executor), so a
+    // select picks its winner before a send to one of its other channels can be taken as well. A close calls it with an empty optional.
+    // Returns false if the channel is closed
+    template <typename F, typename Allocator> bool park(F &&on_send, const Allocator &allocator) {
+        if (this->is_closed()) {
+            return false;
+        }
+        assert(!this->has_ready_reciever() && "a reciever is already waiting");
+        f_ = detail::make_completion<Completion>(
+            [this, on_send = std::forward<F>(on_send)]() mutable {
+                std::optional<args_type> args;
+                if (pending_) {
+                    args.emplace(this->take_pending());
+                }
+                on_send(std::move(args));
+            },
+            detail::parking_allocator(slot_, allocator));
+        return true;
+    }
+
+    // Withdraws the parked reciever without completing it, a select branch that lost or a timed receive that expired. The channel keeps
+    // its values for the next receive
+    void cancel_wait() { f_ = nullptr; }
+
+    // Returns false if the reciever is gone or the queue is full
+    template <typename... U> bool send(U &&...args) { return this->try_send(std::forward<U>(args)...) == send_result::sent; }
+
+    template <typename... U> send_result try_send(U &&...args) {
+        if (!this->has_reciever()) {
+            return send_result::closed;
+        }
+        if (this->has_ready_reciever()) {
+            pending_.emplace(std::forward<U>(args)...);
+            std::exchange(f_, nullptr)();
+        } else if (args_.size() < capacity_) {
+            args_.emplace(std::forward<U>(args)...);
+        } else {
+            return send_result::full;
+        }
+        return send_result::sent;
+    }
+
+    // Asio entrypoint for basic_sender::async_send. Completes with true once the values are queued or handed to the reciever, and
+    // stays blocked while the queue is full. Completes with false if the reciever is (or goes) away.
+    template <typename Self> void send_or_block(Self &&self, args_type &&args) {
+        auto exec = asio::get_associated_executor(self);
+        if (!this->has_reciever()) {
+            detail::complete_from_tuple(self, exec, std::make_tuple(false));
+        } else if (this->has_ready_reciever() || args_.size() < capacity_) {
+            std::apply([this](auto &&...unpacked_args) { this->try_send(std::forward<decltype(unpacked_args)>(unpacked_args)...); },
+                       std::move(args));
+            detail::complete_from_tuple(self, exec, std::make_tuple(true));
+        } else {
+            blocked_senders_.push_back(blocked_sender{
+                std::move(args), [self = std::move(self) /* must be moved, deferred complete */, exec](bool sent) mutable {
+                    asio::post(exec, [self = std::move(self), sent]() mutable { self.complete(sent); });
+                }});
+        }
+    }
+
+    bool has_sender() const { return sender_alive_; }
+    bool has_reciever() const { return reciever_alive_; }
+
+    // Takes no more values once either end is closed or gone, what is queued can still be received
+    bool is_closed() const { return !sender_alive_ || !reciever_alive_; }
+
+    void release_sender() {
+        sender_alive_ = false;
+        this->end_wait();
+    }
+    void release_reciever() {
+        reciever_alive_ = false;
+        for (auto &blocked : std::exchange(blocked_senders_, {})) {
+            blocked.complete_(false);
+        }
+    }
+
+    // Closed from the receiving side, see basic_reciever::close
+    void close() {
+        this->release_reciever();
+        this->end_wait();
+    }
+
+    std::size_t capacity() const { return capacity_; }
+    handoff     handoff_mode() const { return handoff_; }
+
   private:
-    friend sender<Args...>;
-    friend reciever<Args...>;
-    static constexpr auto make_holder() { return std::make_shared<holder>(); }
+    // A cancelled receive (terminal cancellation, e.g. bind_cancellation_slot or the || of awaitable_operators) completes right away
+    // without a value: receive with an empty optional, receive_batch with 0, receive_until with an empty optional. The channel keeps
+    // its values for the next receive. The slot handler only holds a weak reference, the holder may be gone by the time the signal is
+    // emitted
+    template <typename Self> void cancel_on_signal(Self &self) {
+        if constexpr (detail::has_cancellation_state<Self>) {
+            auto slot = self.get_cancellation_state().slot();
+            if (slot.is_connected()) {
+                slot.assign([weak = this->weak_from_this()](asio::cancellation_type type) {
+                    if (type == asio::cancellation_type::none) {
+                        return;
+                    }
+                    if (auto holder = weak.lock()) {
+                        holder->cancel_parked();
+                    }
+                });
+            }
+        }
+    }
+
+    struct blocked_sender {
+        args_type                               args_;
+        rebuild::move_only_function<void(bool)> complete_;
+    };
 
-    bool has_active_sender() const { return not static_cast<bool>(f_); }
     bool has_ready_reciever() const { return static_cast<bool>(f_); }
 
-    std::queue<std::tuple<Args...>>        args_;
-    rebuild::move_only_function<signature> f_{nullptr};
-    bool                                   alive_{true};
+    // The parked completion sees cancelling_ and completes without a value. Nothing to do if it was already woken by a send, its
+    // completion is on the way
+    void cancel_parked() {
+        if (!f_) {
+            return;
+        }
+        cancelling_ = true;
+        std::exchange(f_, nullptr)();
+        cancelling_ = false;
+    }
+
+    // The channel closed under a parked reciever, it is woken with nothing pending. receive reports that with an empty optional,
+    // receive_batch with 0 and a select branch to its state. A resumption cannot and drops its handler
+    void end_wait() {
+        if (f_) {
+            std::exchange(f_, nullptr)();
+        }
+    }
+
+    std::optional<args_type> pop_front() {
+        std::optional<args_type> front;
+        if (!args_.empty()) {
+            front.emplace(std::move(args_.front()));
+            args_.pop();
+        }
+        // A slot opened up (or a reciever showed up at a capacity 0 channel), let the oldest blocked sender in
+        if (!blocked_senders_.empty()) {
+            auto blocked = std::move(blocked_senders_.front());
+            blocked_senders_.pop_front();
+            if (front) {
+                args_.push(std::move(blocked.args_));
+            } else {
+                front.emplace(std::move(blocked.args_));
+            }
+            blocked.complete_(true);
+        }
+        return front;
+    }
+
+    args_type take_pending() {
+        assert(pending_ && "woken without a pending value");
+        auto args = std::move(*pending_);
+        pending_.reset();
+        return args;
+    }
+
+    std::size_t drain_into(std::span<value_type> out) {
+        std::size_t n = 0;
+        while (n < out.size()) {
+            auto front_args_tuple = this->pop_front();
+            if (!front_args_tuple) {
+                break;
+            }
+            out[n++] = detail::value_from_tuple<value_type>(std::move(*front_args_tuple));
+        }
+        return n;
+    }
+
+    std::queue<args_type>      args_;
+    std::deque<blocked_sender> blocked_senders_;
+    std::size_t                capacity_;
+    handoff                    handoff_;
+    std::optional<args_type>   pending_;
+    detail::parking_slot       slot_; // outlives f_
+    Completion                 f_{nullptr};
+    bool                       cancelling_{false};
+    bool                       sender_alive_{true};
+    bool                       reciever_alive_{true};
 };
 
-template <typename... Args> struct reciever {
-    using signature = void(Args...);
+template <typename... Args> using holder = basic_holder<detail::parked_completion, Args...>;
 
-    reciever(holder<Args...>::ptr holder) : holder_(std::move(holder)) {
+template <typename Holder> struct basic_reciever {
+    using holder_type = Holder;
+    using signature   = typename Holder::signature;
+    using value_type  = typename Holder::value_type;
+
+    basic_reciever(Holder::ptr holder) : holder_(std::move(holder)) {
         if (!holder_) {
             throw std::runtime_error("Constructed with nullptr. Cannot create a reciever with no holder");
         }
+        if constexpr (multi_consumer_holder<Holder>) {
+            holder_->attach_reciever();
+        }
     }
 
-    reciever(const sender<Args...> &sender) : holder_(sender.holder_) {
+    basic_reciever(const basic_sender<Holder> &sender) : holder_(sender.holder_) {
         if (!holder_) {
             throw std::runtime_error("Constructed with nullptr. Cannot create a reciever with no holder");
         }
+        if constexpr (multi_consumer_holder<Holder>) {
+            holder_->attach_reciever();
+        }
     }
 
-    ~reciever() {
+    ~basic_reciever() {
         if (holder_) {
             // Make sender know that reciever has is gone.
-            holder_->alive_ = false;
+            holder_->release_reciever();
         }
     }
 
-    // Deleted copy constructor and copy assignment operator
-    reciever &operator=(const reciever &) = delete;
-    reciever(const reciever &) noexcept   = delete;
+    // Copyable only when the holder supports several recievers, copy assignment is always deleted
+    basic_reciever(const basic_reciever &other)
+        requires multi_consumer_holder<Holder>
+        : holder_(other.holder_) {
+        if (holder_) {
+            holder_->attach_reciever();
+        }
+    }
+    basic_reciever &operator=(const basic_reciever &) = delete;
 
-    // Non-deleted move constructor and move assignment operator
-    reciever(reciever &&other) noexcept            = default;
-    reciever &operator=(reciever &&other) noexcept = default;
+    // Non-deleted move constructor and move assignment operator, assignment releases the overwritten end
+    basic_reciever(basic_reciever &&other) noexcept = default;
+    basic_reciever &operator=(basic_reciever &&other) noexcept {
+        if (this != &other) {
+            if (holder_) {
+                holder_->release_reciever();
+            }
+            holder_ = std::move(other.holder_);
+        }
+        return *this;
+    }
 
     bool has_sender() const {
         assert(this->holder_ && "Missing shared state, this reciever is not alive. Must've been moved from");
-        // If lambda is set by anyone else but the reciever, then the sender has destructed.
-        // This is garantueed when the reciever is unique.
-        return holder_->has_active_sender();
+        return holder_->has_sender();
+    }
+
+    bool is_closed() const {
+        assert(this->holder_ && "Missing shared state, this reciever is not alive. Must've been moved from");
+        return holder_->is_closed();
+    }
+
+    // Drain, then stop: sends report send_result::closed from now on (blocked ones complete with false), the values already queued can
+    // still be received and after them receive reports the end of the stream. A parked receive is woken right away
+    void close()
+        requires requires(Holder &h) { h.close(); }
+    {
+        assert(this->holder_ && "Missing shared state, this reciever is not alive. Must've been moved from");
+        holder_->close();
     }
 
     template <typename Self, typename Executor>
@@ -114,83 +879,387 @@ template <typename... Args> struct reciever {
         return (*holder_)(std::forward<Self>(self), std::forward<Executor>(exec));
     }
 
+    template <typename Self, typename Executor> void receive(Self &&self, Executor &&exec) {
+        assert(this->holder_ && "Missing shared state, this reciever is not alive. Must've been moved from");
+        holder_->receive(std::forward<Self>(self), std::forward<Executor>(exec));
+    }
+
+    template <typename Self, typename Executor>
+    [[nodiscard("if false, then the sender is gone AND the queue empty")]] bool receive_batch(Self &&self, Executor &&exec,
+                                                                                              std::span<value_type> out) {
+        assert(this->holder_ && "Missing shared state, this reciever is not alive. Must've been moved from");
+        return holder_->receive_batch(std::forward<Self>(self), std::forward<Executor>(exec), out);
+    }
+
+    template <typename Self, typename Executor>
+    [[nodiscard("if false, then the sender is gone AND the queue empty")]] bool receive_until(Self &&self, Executor &&exec,
+                                                                                              timer_wheel::time_point deadline) {
+        assert(this->holder_ && "Missing shared state, this reciever is not alive. Must've been moved from");
+        return holder_->receive_until(std::forward<Self>(self), std::forward<Executor>(exec), deadline);
+    }
+
+    // Select support, forwarded to the holder, see receive_any
+    auto try_receive()
+        requires selectable_holder<Holder>
+    {
+        assert(this->holder_ && "Missing shared state, this reciever is not alive. Must've been moved from");
+        return holder_->try_receive();
+    }
+
+    template <typename F, typename Allocator>
+        requires selectable_holder<Holder>
+    bool park(F &&on_send, const Allocator &allocator) {
+        assert(this->holder_ && "Missing shared state, this reciever is not alive. Must've been moved from");
+        return holder_->park(std::forward<F>(on_send), allocator);
+    }
+
+    void cancel_wait()
+        requires selectable_holder<Holder>
+    {
+        assert(this->holder_ && "Missing shared state, this reciever is not alive. Must've been moved from");
+        holder_->cancel_wait();
+    }
+
+    handoff handoff_mode() const
+        requires selectable_holder<Holder>
+    {
+        assert(this->holder_ && "Missing shared state, this reciever is not alive. Must've been moved from");
+        return holder_->handoff_mode();
+    }
+
   private:
-    holder<Args...>::ptr holder_;
+    Holder::ptr holder_;
 };
 
-template <typename... Args> struct sender {
-    using signature = void(Args...);
+template <typename Holder> struct basic_sender {
+    using holder_type = Holder;
+    using signature   = typename Holder::signature;
 
-    sender() : sender(holder<Args...>::make_holder()) {}
+    basic_sender() : basic_sender(Holder::make_holder()) {}
 
-    sender(holder<Args...>::ptr holder) : holder_(std::move(holder)) {
+    basic_sender(Holder::ptr holder) : holder_(std::move(holder)) {
         if (!holder_) {
             throw std::runtime_error("Constructed with nullptr. Cannot create a sender with no holder");
         }
+        if constexpr (multi_producer_holder<Holder>) {
+            holder_->attach_sender();
+        }
     }
 
-    ~sender() {
-        // Signal to the receiver that it has lost sender. By setting no-op lambda.
+    ~basic_sender() {
         if (holder_) {
             // Make reciever know the sender is gone.
-            holder_->f_ = [](Args &&...) {};
+            holder_->release_sender();
         }
     }
 
-    // Deleted copy constructor and copy assignment operator
-    sender(const sender &)                     = delete;
-    sender &operator=(const sender &) noexcept = delete;
+    // Copyable only when the holder supports several senders, copy assignment is always deleted
+    basic_sender(const basic_sender &other)
+        requires multi_producer_holder<Holder>
+        : holder_(other.holder_) {
+        if (holder_) {
+            holder_->attach_sender();
+        }
+    }
+    basic_sender &operator=(const basic_sender &) noexcept = delete;
 
-    // Non-deleted move constructor and move assignment operator
-    sender(sender &&other) noexcept            = default;
-    sender &operator=(sender &&other) noexcept = default;
+    // Non-deleted move constructor and move assignment operator, assignment releases the overwritten end
+    basic_sender(basic_sender &&other) noexcept = default;
+    basic_sender &operator=(basic_sender &&other) noexcept {
+        if (this != &other) {
+            if (holder_) {
+                holder_->release_sender();
+            }
+            holder_ = std::move(other.holder_);
+        }
+        return *this;
+    }
 
-    bool operator()(Args &&...args) { return this->send(std::forward<Args>(args)...); }
+    template <typename... U> bool operator()(U &&...args) { return this->send(std::forward<U>(args)...); }
 
-    bool send(Args &&...args) {
+    template <typename... U> bool send(U &&...args) {
         assert(this->holder_ && "Missing shared state, this sender is not alive. Must've been moved from");
-        if (this->has_reciever()) {
-            if (holder_->has_ready_reciever()) {
-                holder_->f_(std::forward<Args>(args)...);
-            } else {
-                holder_->args_.emplace(std::forward<Args>(args)...);
+        return holder_->send(std::forward<U>(args)...);
+    }
+
+    // Sends the elements in order until one is rejected and returns how many were sent. Elements are the value itself for single
+    // argument channels, or std::tuple<Args...>. Elements of an owning rvalue range are moved from
+    template <std::ranges::input_range Range> std::size_t send_bulk(Range &&range) {
+        assert(this->holder_ && "Missing shared state, this sender is not alive. Must've been moved from");
+        constexpr bool move_elements = !std::is_lvalue_reference_v<Range> && !std::ranges::view<std::remove_cvref_t<Range>>;
+
+        std::size_t n = 0;
+        for (auto &&element : range) {
+            using element_ref = std::conditional_t<move_elements, std::remove_reference_t<decltype(element)> &&, decltype(element)>;
+            if (this->try_send_element(static_cast<element_ref>(element)) != send_result::sent) {
+                break;
             }
-            holder_->f_ = nullptr;
-            return true;
+            ++n;
         }
-        return false;
+        return n;
+    }
+
+    // Never blocks, reports send_result::full instead of growing a bounded channel
+    template <typename... U> send_result try_send(U &&...args) {
+        assert(this->holder_ && "Missing shared state, this sender is not alive. Must've been moved from");
+        return holder_->try_send(std::forward<U>(args)...);
+    }
+
+    // Suspends while a bounded channel is full, completes with void(bool) like send(). Only for holders with send_or_block
+    template <typename CompletionToken, typename... U> auto async_send(CompletionToken &&token, U &&...args) {
+        assert(this->holder_ && "Missing shared state, this sender is not alive. Must've been moved from");
+        return asio::async_compose<CompletionToken, void(bool)>(
+            [holder = holder_, args = typename Holder::args_type(std::forward<U>(args)...)]<typename Self>(Self &&self) mutable {
+                holder->send_or_block(std::forward<Self>(self), std::move(args));
+            },
+            token);
     }
 
     bool has_reciever() const {
         assert(this->holder_ && "Missing shared state, this sender is not alive. Must've been moved from");
-        return holder_->alive_;
+        return holder_->has_reciever();
+    }
+
+    // Lets go of the channel now instead of at destruction, the sender is empty afterwards (like a moved from one). Once no sender is
+    // left the reciever gets what is queued and then the end of the stream, a parked receive is woken right away
+    void close() {
+        if (holder_) {
+            holder_->release_sender();
+            holder_.reset();
+        }
     }
 
     auto make_reciever() {
         assert(this->holder_ && "Missing shared state, this sender is not alive. Must've been moved from");
-        return reciever<Args...>(holder_);
+        return basic_reciever<Holder>(holder_);
     }
 
   private:
-    holder<Args...>::ptr holder_;
+    friend basic_reciever<Holder>;
+
+    template <typename Element> send_result try_send_element(Element &&element) {
+        if constexpr (std::is_same_v<std::remove_cvref_t<Element>, typename Holder::args_type>) {
+            return std::apply([this](auto &&...unpacked) { return holder_->try_send(std::forward<decltype(unpacked)>(unpacked)...); },
+                              std::forward<Element>(element));
+        } else {
+            return holder_->try_send(std::forward<Element>(element));
+        }
+    }
+
+    Holder::ptr holder_;
 };
 
-template <typename... Args> auto make_sender() { return sender<Args...>(); }
+template <typename... Args> using sender   = basic_sender<holder<Args...>>;
+template <typename... Args> using reciever = basic_reciever<holder<Args...>>;
+
+template <typename... Args> auto make_sender(std::size_t capacity = unbounded, handoff mode = handoff::post) {
+    return sender<Args...>(holder<Args...>::make_holder(capacity, mode));
+}
 
 template <typename Sender> auto make_reciever_from(const Sender &sender) { return sender.make_reciever(); }
 
-template <typename... Args> auto make_sender_reciever_pair() {
-    auto h = std::make_shared<holder<Args...>>();
+template <typename... Args> auto make_sender_reciever_pair(std::size_t capacity = unbounded, handoff mode = handoff::post) {
+    auto h = holder<Args...>::make_holder(capacity, mode);
     return std::make_pair(sender<Args...>(h), reciever<Args...>(h));
 }
 
-template <typename Executor, typename... Args> auto awaitable_resumption(reciever<Args...> &rhs, Executor &exec) {
-    constexpr auto n_args = sizeof...(Args);
-    if constexpr (n_args <= 1) {
-        return resumption(rhs, asio::use_awaitable, exec);
+namespace detail {
+// awaitable_resumption as a composed operation over receive, whose empty optional tells a cancelled wait from a closed channel. The
+// value completed together with an exception is never read, use_awaitable throws the exception instead
+template <typename Holder, typename Executor> struct resume_or_throw {
+    using value_type = typename Holder::value_type;
+
+    static constexpr bool has_value = std::tuple_size_v<typename Holder::args_type> > 0;
+    using signature = std::conditional_t<has_value, void(std::exception_ptr, value_type), void(std::exception_ptr)>;
+
+    template <typename Self> void operator()(Self &self) {
+        open_     = !reciever_.is_closed();
+        auto exec = exec_; // This object moves into the receive along with self
+        receive(reciever_, std::move(self), exec);
+    }
+
+    template <typename Self> void operator()(Self &self, std::optional<value_type> value) {
+        if (value) {
+            complete(self, nullptr, std::move(*value));
+        } else if (!open_) {
+            complete(self, std::make_exception_ptr(std::runtime_error("No sender or queue empty")), value_type{});
+        } else if (!reciever_.is_closed()) {
+            complete(self, std::make_exception_ptr(asio::system_error(asio::error::operation_aborted)), value_type{});
+        }
+        // else: closed while parked, the handler is dropped like resumption's
+    }
+
+    template <typename Self> static void complete(Self &self, std::exception_ptr error, value_type &&value) {
+        if constexpr (has_value) {
+            self.complete(std::move(error), std::move(value));
+        } else {
+            self.complete(std::move(error));
+        }
+    }
+
+    basic_reciever<Holder> &reciever_;
+    Executor                exec_;
+    bool                    open_{false};
+};
+
+// Never completes. The handler, and with it the awaiting coroutine, is released from the executor like a dropped resumption
+template <typename Executor> auto abandon(const Executor &exec) {
+    return asio::async_compose<const asio::use_awaitable_t<> &, void()>(
+        [exec]<typename Self>(Self &&self) { asio::post(exec, [self = std::move(self)] {}); }, asio::use_awaitable, exec);
+}
+
+// The same for a value_type that cannot stand in next to an exception, at the cost of a coroutine frame per call
+template <typename Holder, typename Executor>
+asio::awaitable<typename Holder::value_type> resume_or_throw_in_frame(basic_reciever<Holder> &rhs, Executor exec) {
+    const bool open  = !rhs.is_closed();
+    auto       value = co_await receive(rhs, asio::use_awaitable, exec);
+    if (!value) {
+        if (!open) {
+            throw std::runtime_error("No sender or queue empty");
+        }
+        if (rhs.is_closed()) {
+            co_await abandon(exec); // Never resumes
+        }
+        throw asio::system_error(asio::error::operation_aborted);
+    }
+    co_return std::move(*value);
+}
+} // namespace detail
+
+// The value of the next send, a tuple for several Args. Like resumption it throws on a closed and drained channel and drops a wait that
+// is parked when the channel closes. A cancelled wait (e.g. the losing side of awaitable_operators' ||) throws asio::system_error with
+// operation_aborted, the way asio's own operations report it
+template <typename Executor, typename Holder> auto awaitable_resumption(basic_reciever<Holder> &rhs, Executor &exec) {
+    using operation = detail::resume_or_throw<Holder, std::decay_t<Executor>>;
+    if constexpr (std::is_default_constructible_v<typename Holder::value_type>) {
+        return asio::async_compose<const asio::use_awaitable_t<> &, typename operation::signature>(operation{rhs, exec}, asio::use_awaitable,
+                                                                                                 exec);
     } else {
-        return resumption(rhs, asio::as_tuple(asio::use_awaitable), exec);
+        return detail::resume_or_throw_in_frame(rhs, exec);
+    }
+}
+
+template <typename Executor, typename Holder> auto awaitable_receive(basic_reciever<Holder> &rhs, Executor &exec) {
+    return receive(rhs, asio::use_awaitable, exec);
+}
+
+template <typename Executor, typename Holder>
+auto awaitable_receive_batch(basic_reciever<Holder> &rhs, std::span<typename Holder::value_type> out, Executor &exec) {
+    return receive_batch(rhs, out, asio::use_awaitable, exec);
+}
+
+namespace detail {
+// Shared by the branches of one receive_any, the parked branches own it. The holders are single threaded, so the first send to reach a
+// branch wins and withdraws the other branches before it returns, none of them can fire afterwards and no value is lost. A close wakes
+// its branch with nothing, the select ends once every parked branch has been closed
+template <typename Self, typename Executor, typename Value, typename... Recievers>
+struct select_state : std::enable_shared_from_this<select_state<Self, Executor, Value, Recievers...>> {
+    select_state(Self self, Executor exec, std::tuple<Recievers &...> recievers)
+        : self_(std::move(self)), exec_(std::move(exec)), recievers_(recievers) {}
+
+    template <std::size_t I, typename Allocator> void park(const Allocator &allocator) {
+        auto parked = std::get<I>(recievers_).park(
+            [state = this->shared_from_this()](auto &&args) mutable {
+                if (args) {
+                    state->template won<I>(std::move(*args));
+                } else {
+                    state->template closed<I>();
+                }
+            },
+            allocator);
+        if (parked) {
+            ++open_;
+        }
     }
+
+    template <std::size_t I, typename Args> void won(Args &&args) {
+        [this]<std::size_t... J>(std::index_sequence<J...>) {
+            ((J != I ? std::get<J>(recievers_).cancel_wait() : void()), ...);
+        }(std::index_sequence_for<Recievers...>{});
+
+        using value_type = typename std::tuple_element_t<I, std::tuple<Recievers...>>::value_type;
+        Value value(std::in_place_index<I>, value_from_tuple<value_type>(std::forward<Args>(args)));
+        wake(std::get<I>(recievers_).handoff_mode(), exec_,
+             [self = std::move(self_), value = std::move(value)]() mutable { self.complete(I, std::move(value)); });
+    }
+
+    template <std::size_t I> void closed() {
+        if (--open_ > 0) {
+            return;
+        }
+        wake(std::get<I>(recievers_).handoff_mode(), exec_, [self = std::move(self_)]() mutable {
+            self.complete(sizeof...(Recievers), Value(std::in_place_index<sizeof...(Recievers)>));
+        });
+    }
+
+    Self                       self_;
+    Executor                   exec_;
+    std::tuple<Recievers &...> recievers_;
+    std::size_t                open_{0};
+};
+} // namespace detail
+
+/**
+ * Waits on several channels at once and completes with void(std::size_t index, std::variant<value_type..., std::monostate>) for the
+ * first value, e.g.
+ *   auto [index, value] = co_await awaitable_receive_any(exec, prices, orders);
+ * The variant alternative is the index of the channel, so channels of the same type can be told apart. Once every channel is closed and
+ * drained it completes with index sizeof...(Holders) and the trailing std::monostate, right away or when the last parked one closes.
+ *
+ * Queued values are taken first, in argument order. Otherwise every open channel gets a parked branch, all sharing one state allocated
+ * with the handler's allocator. The recievers must stay alive and be used from one thread (or strand) until it completes.
+ */
+template <typename CompletionToken, typename Executor, typename... Holders>
+    requires(sizeof...(Holders) > 0 && (selectable_holder<Holders> && ...))
+auto receive_any(std::tuple<basic_reciever<Holders> &...> recievers, CompletionToken &&token, Executor &&exec) {
+    using value_variant = std::variant<typename Holders::value_type..., std::monostate>;
+    return asio::async_compose<CompletionToken, void(std::size_t, value_variant)>(
+        [recievers, &exec]<typename Self>(Self &&self) {
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                std::optional<std::tuple<std::size_t, value_variant>> ready;
+                auto take_queued = [&]<std::size_t J>(std::integral_constant<std::size_t, J>) {
+                    if (auto args = std::get<J>(recievers).try_receive()) {
+                        using value_type = typename std::tuple_element_t<J, std::tuple<Holders...>>::value_type;
+                        ready.emplace(J, value_variant(std::in_place_index<J>, detail::value_from_tuple<value_type>(std::move(*args))));
+                        return true;
+                    }
+                    return false;
+                };
+                if ((take_queued(std::integral_constant<std::size_t, I>{}) || ...)) {
+                    detail::complete_from_tuple(self, exec, std::move(*ready));
+                    return;
+                }
+                if ((std::get<I>(recievers).is_closed() && ...)) {
+                    detail::complete_from_tuple(
+                        self, exec, std::make_tuple(sizeof...(Holders), value_variant(std::in_place_index<sizeof...(Holders)>)));
+                    return;
+                }
+
+                using state_type = detail::select_state<std::decay_t<Self>, std::decay_t<Executor>, value_variant, basic_reciever<Holders>...>;
+                auto allocator   = detail::recycling_allocator_for(self);
+                auto state       = std::allocate_shared<state_type>(allocator, std::move(self), exec, recievers);
+                (state->template park<I>(allocator), ...);
+            }(std::index_sequence_for<Holders...>{});
+        },
+        token, exec);
+}
+
+template <typename Executor, typename... Holders> auto awaitable_receive_any(Executor &exec, basic_reciever<Holders> &...recievers) {
+    return receive_any(std::tie(recievers...), asio::use_awaitable, exec);
+}
+
+template <typename Executor, typename Holder>
+auto awaitable_receive_until(basic_reciever<Holder> &rhs, timer_wheel::time_point deadline, Executor &exec) {
+    return receive_until(rhs, deadline, asio::use_awaitable, exec);
+}
+
+template <typename Executor, typename Holder, typename Rep, typename Period>
+auto awaitable_receive_for(basic_reciever<Holder> &rhs, std::chrono::duration<Rep, Period> timeout, Executor &exec) {
+    return receive_for(rhs, timeout, asio::use_awaitable, exec);
+}
+
+template <typename Holder, typename... U> auto awaitable_send(basic_sender<Holder> &lhs, U &&...args) {
+    return lhs.async_send(asio::use_awaitable, std::forward<U>(args)...);
 }
 
 } // namespace rebuild::async
\ No newline at end of file
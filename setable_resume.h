@@ -1,37 +1,125 @@
 #pragma once
+#ifdef ASIO_STANDALONE
+#include <asio/associated_executor.hpp>
+#include <asio/dispatch.hpp>
+#else
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/dispatch.hpp>
+#endif
+#include <atomic>
+#include <cassert>
+#include <cstdint>
 #include <infrastructure/move_only_function.h>
 #include <memory>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
 
 namespace rebuild::async {
 
-template <typename R, typename... Args> struct asio_setter : std::enable_shared_from_this<asio_setter<R, Args...>> {
+// Function stores the completion, e.g. rebuild::inplace_function<Signature, N> for an allocation free (compile time checked) setter
+template <typename Signature, typename Function = rebuild::move_only_function<Signature>> struct asio_setter;
+
+/**
+ * One-shot slot between a waiting asio operation (operator(), on the waiter's executor) and fire(), which may be called from any thread.
+ *
+ *   empty -> armed -> empty    the handler was stored first, fire() takes it and completes
+ *   empty -> fired -> empty    fired before the handler arrived, the arguments wait in the slot and operator() completes
+ *
+ * Each side makes one compare-exchange and whichever comes second completes, so there is no lock and no lost wakeup. The handler always
+ * runs through asio::dispatch on its associated executor: inline when fired from that executor's thread, posted from anywhere else. Once
+ * completed the slot is empty and can be armed again, e.g. by the next co_await of the same waiter. Exactly one fire() per arming.
+ */
+template <typename R, typename... Args, typename Function>
+struct asio_setter<R(Args...), Function> : std::enable_shared_from_this<asio_setter<R(Args...), Function>> {
     using signature = R(Args...);
     using ptr       = std::shared_ptr<asio_setter>;
     using weak_ptr  = ptr::weak_type;
 
-    rebuild::move_only_function<R(Args...)> f_{nullptr};
-
     // Asio entrypoint for async_compose. Will make the handle ready
     template <typename Self> void operator()(Self &&self) {
-        f_ = [self = std::move(self)](Args &&...args) mutable { self.complete(std::forward<Args>(args)...); };
+        // Written before the state is published, fire() reads it only after seeing armed
+        f_ = [self = std::move(self)](Args &&...args) mutable {
+            auto exec = asio::get_associated_executor(self);
+            asio::dispatch(exec, [self = std::move(self), args = std::tuple<Args...>(std::forward<Args>(args)...)]() mutable {
+                std::apply([&self](auto &&...unpacked) { self.complete(std::forward<decltype(unpacked)>(unpacked)...); }, std::move(args));
+            });
+        };
+
+        auto expected = state::empty;
+        if (state_.compare_exchange_strong(expected, state::armed, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return;
+        }
+        assert(expected == state::fired && "a handler is already waiting");
+
+        // Fired first, the arguments are ours. Empty the slot before completing, the completion may arm it again
+        auto f    = std::exchange(f_, nullptr);
+        auto args = std::move(*args_);
+        args_.reset();
+        state_.store(state::empty, std::memory_order_release);
+        std::apply(f, std::move(args));
+    }
+
+    // Any thread, exactly once per arming (it may come before the handler is armed)
+    void fire(Args &&...args) {
+        auto expected = state::armed;
+        if (state_.compare_exchange_strong(expected, state::empty, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            // Nothing arms the slot again before this completion runs, f_ is ours
+            std::exchange(f_, nullptr)(std::forward<Args>(args)...);
+            return;
+        }
+        assert(expected == state::empty && "fired twice");
+
+        args_.emplace(std::forward<Args>(args)...);
+        if (state_.compare_exchange_strong(expected, state::fired, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return;
+        }
+
+        // Armed in between, take the arguments back and complete here
+        assert(expected == state::armed && "fired twice");
+        auto f         = std::exchange(f_, nullptr);
+        auto args_back = std::move(*args_);
+        args_.reset();
+        state_.store(state::empty, std::memory_order_release);
+        std::apply(f, std::move(args_back));
+    }
+
+    bool armed() const { return state_.load(std::memory_order_acquire) == state::armed; }
+
+    // Nobody fires anymore. Drops a waiting handler (and with it the operation), or arguments that were never picked up
+    void disarm() {
+        auto expected = state::armed;
+        if (state_.compare_exchange_strong(expected, state::empty, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            f_ = nullptr;
+        } else if (expected == state::fired &&
+                   state_.compare_exchange_strong(expected, state::empty, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            args_.reset();
+        }
     }
+
+  private:
+    enum class state : std::uint8_t { empty, armed, fired };
+
+    Function                           f_{nullptr};
+    std::optional<std::tuple<Args...>> args_;
+    std::atomic<state>                 state_{state::empty};
 };
 
-template <typename Signature> struct setable_resume;
+template <typename Signature, typename Function = rebuild::move_only_function<Signature>> struct setable_resume;
 
-template <typename R, typename... Args> struct setable_resume<R(Args...)> {
+template <typename R, typename... Args, typename Function> struct setable_resume<R(Args...), Function> {
     using signature = R(Args...);
 
-    setable_resume() : holder_(std::make_shared<asio_setter<R, Args...>>()) {}
+    setable_resume() : holder_(std::make_shared<asio_setter<R(Args...), Function>>()) {}
 
-    ~setable_resume() { holder_->f_ = nullptr; }
+    ~setable_resume() { holder_->disarm(); }
 
+    // Any thread, once per wait. The waiter resumes on its own executor, see asio_setter
     void resume(Args &&...args)
         requires std::is_void_v<R>
     {
-        assert(this->is_set() && "The resume function has not yet been set, or has been cleared");
-        holder_->f_(std::forward<Args>(args)...);
-        holder_->f_ = nullptr;
+        holder_->fire(std::forward<Args>(args)...);
     }
 
     auto resume(Args &&...)
@@ -40,11 +128,12 @@ template <typename R, typename... Args> struct setable_resume<R(Args...)> {
         throw std::runtime_error("not implemented");
     }
 
-    bool is_set() const { return static_cast<bool>(holder_->f_); }
+    // A waiter is armed and not resumed yet
+    bool is_set() const { return holder_->armed(); }
 
     auto weak_ptr() { return holder_->weak_from_this(); }
 
   private:
-    asio_setter<R, Args...>::ptr holder_;
+    asio_setter<R(Args...), Function>::ptr holder_;
 };
-} // namespace rebuild::async
\ No newline at end of file
+} // namespace rebuild::async
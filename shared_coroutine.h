@@ -1,16 +1,25 @@
 #pragma once
 
+#include <async/basic_promise.h>
+#include <atomic>
+#include <cassert>
 #include <concepts>
 #include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <infrastructure/frame_pool.h>
+#include <infrastructure/trace.h>
+#include <memory>
 // #include <nameof.hpp>
-#include <spdlog/spdlog.h>
 #include <type_traits>
 #include <utility>
 
 template <typename TaskHandle, bool IsDetached = false> struct SharedCoroutine {
   using handle_type = TaskHandle;
 
-  struct promise_type {
+  // Frames come from rebuild::frame_pool, or from a std::pmr::memory_resource
+  // passed as (std::allocator_arg, resource, ...)
+  struct promise_type : rebuild::pooled_frame {
     static constexpr bool is_detached = IsDetached;
 
     // The shared/weak ptr to **
@@ -19,20 +28,23 @@ template <typename TaskHandle, bool IsDetached = false> struct SharedCoroutine {
         task;
 
     auto get_return_object() {
-      spdlog::info("get_return_object [SharedCoroutine]");
+      COROS_TRACE("get_return_object [SharedCoroutine]", this);
       return SharedCoroutine(
           std::coroutine_handle<promise_type>::from_promise(*this));
     }
     std::suspend_always initial_suspend() {
-      spdlog::info("initial_suspend [SharedCoroutine]");
+      COROS_TRACE("initial_suspend [SharedCoroutine]", this);
       return {};
     }
     std::suspend_always final_suspend() noexcept {
-      spdlog::info("final_suspend [SharedCoroutine]");
+      COROS_TRACE("final_suspend [SharedCoroutine]", this);
       return {};
     }
-    void unhandled_exception() { std::terminate(); }
-    void return_void() { spdlog::info("return_void [SharedCoroutine]"); }
+    // Rethrown to the thread that resumed the task, see TaskImpl::run()
+    void unhandled_exception() { exception.capture(); }
+    void return_void() { COROS_TRACE("return_void [SharedCoroutine]", this); }
+
+    exception_slot exception;
 
     auto shared_from_this() {
       if constexpr (is_detached) {
@@ -50,21 +62,23 @@ template <typename TaskHandle, bool IsDetached = false> struct SharedCoroutine {
   };
 
   explicit SharedCoroutine(std::coroutine_handle<promise_type> h)
-      : task(std::make_shared<TaskHandle>(h)) {
-    spdlog::info("explicit SharedCoroutine(handle) [SharedCoroutine]");
+      : task(std::allocate_shared<TaskHandle>(
+            rebuild::frame_pool_allocator<TaskHandle>{}, h)) {
+    COROS_TRACE("explicit SharedCoroutine(handle) [SharedCoroutine]", this);
     if constexpr (IsDetached) {
       h.promise().task = task->shared_from_this();
     } else {
       h.promise().task = task->weak_from_this();
     }
   }
-  ~SharedCoroutine() { spdlog::info("~SharedCoroutine [destructed]"); }
+  ~SharedCoroutine() { COROS_TRACE("~SharedCoroutine [destructed]", this); }
 
   SharedCoroutine &operator=(const SharedCoroutine &) = delete;
 
   // Allow implicit conversion to shared_ptr
   operator typename TaskHandle::Ptr() const {
-    spdlog::info("implicit SharedTask::Ptr() conversion [SharedCoroutine]");
+    COROS_TRACE("implicit SharedTask::Ptr() conversion [SharedCoroutine]",
+                this);
     return task;
   }
 
@@ -73,57 +87,151 @@ private:
   TaskHandle::Ptr task;
 };
 
+/**
+ * Shared owner of a SharedCoroutine frame.
+ *
+ * Resumption is guarded by one atomic state word instead of a mutex:
+ *   idle      -> running    resume()/try_resume() won the CAS and resumes
+ *   running   -> scheduled  resume() while another resumption is in progress,
+ *                           the running thread resumes once more afterwards
+ *   running   -> idle       the coroutine suspended again
+ *   running   -> done       the coroutine finished
+ * So resuming never blocks, and resuming from inside the coroutine itself
+ * (e.g. an inline completion) is deferred instead of deadlocking.
+ *
+ * An exception escaping the coroutine finishes it and is rethrown from the
+ * resume()/try_resume() call that ran it, exception() keeps it afterwards.
+ */
 struct TaskImpl : std::enable_shared_from_this<TaskImpl> {
   using Ptr = std::shared_ptr<TaskImpl>;
   using Self = TaskImpl;
 
+  enum class state : std::uint8_t { idle, running, scheduled, done };
+
+  // Intrusive completion callback, see notify_when_done()
+  struct done_waiter {
+    void (*notify)(done_waiter *);
+  };
+
   explicit TaskImpl(
       std::coroutine_handle<SharedCoroutine<Self>::promise_type> h)
-      : handle_(h) {
-    spdlog::debug(
-        "explicit TaskImpl(handle<SharedCoroutine<Self>>) [TaskImpl]");
+      : handle_(h), state_(h ? state::idle : state::done),
+        waiter_(h ? nullptr : done_marker()) {
+    COROS_TRACE("explicit TaskImpl(handle<SharedCoroutine<Self>>) [TaskImpl]",
+                this);
   }
   ~TaskImpl() {
-    spdlog::debug("~TaskImpl() [TaskImpl]");
+    COROS_TRACE("~TaskImpl() [TaskImpl]", this);
     if (handle_) {
       handle_.destroy();
     }
   }
 
+  // Resumes only if nobody else is resuming right now
   bool try_resume() {
-    spdlog::debug("try_resume() (handle<SharedCoroutine<Self>>) [TaskImpl]");
-    std::unique_lock lock(mutex_, std::defer_lock);
-
-    if (lock.try_lock() && handle_ && !handle_.done()) {
-      handle_.resume();
-      return true;
-    } else {
+    COROS_TRACE("try_resume() (handle<SharedCoroutine<Self>>) [TaskImpl]",
+                this);
+    auto expected = state::idle;
+    if (!state_.compare_exchange_strong(expected, state::running,
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed)) {
       return false;
     }
+    run();
+    return true;
   }
 
+  // Resumes now, or makes the thread that is resuming right now resume once
+  // more. Returns false if the coroutine is done
   bool resume() {
-    spdlog::debug("resume() (handle<SharedCoroutine<Self>>) [TaskImpl]");
-    std::lock_guard lock(mutex_);
-    if (handle_ && !handle_.done()) {
-      handle_.resume();
-      return true;
-    } else {
-      return false;
+    COROS_TRACE("resume() (handle<SharedCoroutine<Self>>) [TaskImpl]", this);
+    auto current = state_.load(std::memory_order_relaxed);
+    for (;;) {
+      switch (current) {
+      case state::idle:
+        if (state_.compare_exchange_weak(current, state::running,
+                                         std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+          run();
+          return true;
+        }
+        break;
+      case state::running:
+        if (state_.compare_exchange_weak(current, state::scheduled,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+          return true;
+        }
+        break;
+      case state::scheduled:
+        return true;
+      case state::done:
+        return false;
+      }
     }
   }
 
-  bool is_done() {
-    std::lock_guard lock(mutex_);
-    if (!handle_ || handle_.done()) {
-      return true;
-    } else {
-      return false;
-    }
+  bool is_done() const {
+    return state_.load(std::memory_order_acquire) == state::done;
+  }
+
+  // Calls waiter->notify(waiter) once the coroutine finishes, on the thread
+  // that finishes it. One waiter at a time. Returns false if already done
+  bool notify_when_done(done_waiter *waiter) {
+    done_waiter *expected = nullptr;
+    auto registered = waiter_.compare_exchange_strong(
+        expected, waiter, std::memory_order_acq_rel, std::memory_order_acquire);
+    assert((registered || expected == done_marker()) && "one waiter at a time");
+    return registered;
+  }
+
+  // Withdraws a registered waiter. Returns false if it is being, or has
+  // been, notified
+  bool cancel_notify(done_waiter *waiter) {
+    return waiter_.compare_exchange_strong(waiter, nullptr,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_relaxed);
+  }
+
+  // What escaped the coroutine, if anything. Only meaningful once done
+  std::exception_ptr exception() const {
+    return handle_ ? handle_.promise().exception.get() : nullptr;
   }
 
-  std::mutex mutex_;
   std::coroutine_handle<SharedCoroutine<Self>::promise_type> handle_;
+
+private:
+  // Must own the running state
+  void run() {
+    for (;;) {
+      handle_.resume();
+      if (handle_.done()) {
+        state_.store(state::done, std::memory_order_release);
+        if (auto *waiter =
+                waiter_.exchange(done_marker(), std::memory_order_acq_rel)) {
+          waiter->notify(waiter);
+        }
+        handle_.promise().exception.rethrow_if_any();
+        return;
+      }
+      auto expected = state::running;
+      if (state_.compare_exchange_strong(expected, state::idle,
+                                         std::memory_order_release,
+                                         std::memory_order_acquire)) {
+        return;
+      }
+      // Scheduled while running, take it back and go again
+      state_.store(state::running, std::memory_order_relaxed);
+    }
+  }
+
+  static done_waiter *done_marker() {
+    static done_waiter marker{nullptr};
+    return &marker;
+  }
+
+  std::atomic<state> state_;
+  std::atomic<done_waiter *> waiter_;
 };
 
 using SharedTask = SharedCoroutine<TaskImpl>;
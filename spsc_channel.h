@@ -0,0 +1,202 @@
+#pragma once
+#include <async/sender_reciever.h>
+#include <atomic>
+#include <infrastructure/spsc_ring_buffer.h>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+
+namespace rebuild::async {
+
+/**
+ * Bounded single-producer/single-consumer holder backed by a lock-free ring buffer.
+ *
+ * The sender may live on one thread and the reciever on another (typically an io_context thread). Values always travel through the ring
+ * buffer, a reciever that finds it empty parks its completion and raises waiting_. Parking and sending use the usual store -> fence ->
+ * load handshake, so either the sender sees waiting_ or the reciever sees the value, and the exchange on waiting_ decides who wakes it.
+ * The woken reciever pops on its own executor, the sender only posts the wake and never touches the completion handler.
+ */
+template <typename... Args> struct spsc_holder : std::enable_shared_from_this<spsc_holder<Args...>> {
+    using ptr        = std::shared_ptr<spsc_holder>;
+    using signature  = void(Args...);
+    using args_type  = std::tuple<Args...>;
+    using value_type = detail::batch_value<Args...>::type;
+
+    // Rounded up to a power of two by the ring buffer, capacity() reports how many values actually fit
+    explicit spsc_holder(std::size_t capacity) : args_(capacity) {}
+
+    static auto make_holder(std::size_t capacity) { return std::make_shared<spsc_holder>(capacity); }
+
+    // Asio entrypoint for async_compose. Will make the handle ready
+    template <typename Self, typename Executor>
+    [[nodiscard("if false, then the sender is gone AND the queue empty")]] bool operator()(Self &&self, Executor &&exec) {
+        if (this->complete_from_queue(self, exec)) {
+            return true;
+        }
+        if (this->is_closed()) {
+            // The sender may have pushed its last values right before leaving
+            return this->complete_from_queue(self, exec);
+        }
+
+        // Once parked, the reciever may be completed and destroyed on another thread before this call returns
+        auto keep_alive = this->shared_from_this();
+
+        parked_.park(std::move(self), [this, exec](auto &self) {
+            // Nothing to pop means the channel was closed while we were parked, the operation is abandoned like in holder
+            [[maybe_unused]] auto completed = this->complete_from_queue(self, exec);
+        });
+        this->park();
+        return true;
+    }
+
+    // Asio entrypoint for receive. Completes with the next value, or with an empty optional once the channel is closed and drained
+    template <typename Self, typename Executor> void receive(Self &&self, Executor &&exec) {
+        if (this->template complete_from_queue<true>(self, exec)) {
+            return;
+        }
+        if (this->is_closed()) {
+            // The sender may have pushed its last values right before leaving
+            if (!this->template complete_from_queue<true>(self, exec)) {
+                detail::complete_from_tuple(self, exec, std::make_tuple(std::optional<value_type>()));
+            }
+            return;
+        }
+
+        // Once parked, the reciever may be completed and destroyed on another thread before this call returns
+        auto keep_alive = this->shared_from_this();
+
+        parked_.park(std::move(self), [this, exec](auto &self) {
+            // Nothing to pop means the channel was closed while we were parked
+            if (!this->template complete_from_queue<true>(self, exec)) {
+                self.complete(std::optional<value_type>());
+            }
+        });
+        this->park();
+    }
+
+    // Asio entrypoint for receive_batch. Drains what is in the buffer, or parks until the next send and then drains again. Completes with
+    // 0 once the channel is closed and drained
+    template <typename Self, typename Executor>
+    [[nodiscard("if false, then the sender is gone AND the queue empty")]] bool receive_batch(Self &&self, Executor &&exec,
+                                                                                              std::span<value_type> out) {
+        auto n = this->drain_into(out);
+        if (n == 0 && !out.empty() && this->is_closed()) {
+            // The sender may have pushed its last values right before leaving
+            n = this->drain_into(out);
+            detail::complete_from_tuple(self, exec, std::make_tuple(n));
+            return true;
+        }
+        if (n > 0 || out.empty()) {
+            detail::complete_from_tuple(self, exec, std::make_tuple(n));
+            return true;
+        }
+
+        // Once parked, the reciever may be completed and destroyed on another thread before this call returns
+        auto keep_alive = this->shared_from_this();
+
+        parked_.park(std::move(self), [this, out](auto &self) {
+            // Nothing to take means the channel was closed while we were parked
+            self.complete(this->drain_into(out));
+        });
+        this->park();
+        return true;
+    }
+
+    // Returns false if the reciever is gone or the buffer is full
+    template <typename... U> bool send(U &&...args) { return this->try_send(std::forward<U>(args)...) == send_result::sent; }
+
+    template <typename... U> send_result try_send(U &&...args) {
+        if (!this->has_reciever()) {
+            return send_result::closed;
+        }
+        if (!args_.try_emplace(std::forward<U>(args)...)) {
+            return send_result::full;
+        }
+        this->wake_reciever();
+        return send_result::sent;
+    }
+
+    bool has_sender() const { return sender_alive_.load(std::memory_order_acquire); }
+    bool has_reciever() const { return reciever_alive_.load(std::memory_order_acquire); }
+
+    void release_sender() {
+        sender_alive_.store(false, std::memory_order_release);
+        this->wake_reciever();
+    }
+    void release_reciever() { reciever_alive_.store(false, std::memory_order_release); }
+
+    // Closed from the receiving side, see basic_reciever::close. Only the reciever's thread calls this, the wake is for a parked receive
+    void close() {
+        this->release_reciever();
+        this->wake_reciever();
+    }
+
+    bool is_closed() const { return !this->has_sender() || !this->has_reciever(); }
+
+    std::size_t capacity() const { return args_.capacity(); }
+
+  private:
+    // AsOptional completes with std::optional<value_type> (receive) instead of Args... (resumption)
+    template <bool AsOptional = false, typename Self, typename Executor> bool complete_from_queue(Self &self, Executor &exec) {
+        // Pop before completing, the completion may resume the reciever inline and it may pop again
+        auto front_args_tuple = args_.try_pop();
+        if (!front_args_tuple) {
+            return false;
+        }
+        if constexpr (AsOptional) {
+            auto value = std::optional<value_type>(detail::value_from_tuple<value_type>(std::move(*front_args_tuple)));
+            detail::complete_from_tuple(self, exec, std::make_tuple(std::move(value)));
+        } else {
+            detail::complete_from_tuple(self, exec, std::move(*front_args_tuple));
+        }
+        return true;
+    }
+
+    std::size_t drain_into(std::span<value_type> out) {
+        std::size_t n = 0;
+        while (n < out.size()) {
+            auto front_args_tuple = args_.try_pop();
+            if (!front_args_tuple) {
+                break;
+            }
+            out[n++] = detail::value_from_tuple<value_type>(std::move(*front_args_tuple));
+        }
+        return n;
+    }
+
+    // parked_ must be set
+    void park() {
+        waiting_.store(true, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // Re-check, the sender may have pushed (or left) between the failed pop and raising waiting_
+        if ((!args_.empty() || this->is_closed()) && waiting_.exchange(false, std::memory_order_acq_rel)) {
+            parked_.wake(this->shared_from_this());
+        }
+    }
+
+    void wake_reciever() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_relaxed) && waiting_.exchange(false, std::memory_order_acq_rel)) {
+            parked_.wake(this->shared_from_this());
+        }
+    }
+
+    rebuild::spsc_ring_buffer<args_type>                 args_;
+    detail::remote_parked                                parked_;
+    alignas(rebuild::cache_line_size) std::atomic<bool> waiting_{false};
+    std::atomic<bool>                                    sender_alive_{true};
+    std::atomic<bool>                                    reciever_alive_{true};
+};
+
+template <typename... Args> using spsc_sender   = basic_sender<spsc_holder<Args...>>;
+template <typename... Args> using spsc_reciever = basic_reciever<spsc_holder<Args...>>;
+
+// The channel holds std::bit_ceil(capacity) values (at least 1), e.g. a capacity of 5 gives 8 and send() reports full on the 9th value
+template <typename... Args> auto make_spsc_sender_reciever_pair(std::size_t capacity) {
+    auto h = spsc_holder<Args...>::make_holder(capacity);
+    return std::make_pair(spsc_sender<Args...>(h), spsc_reciever<Args...>(h));
+}
+
+} // namespace rebuild::async
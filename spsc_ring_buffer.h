@@ -0,0 +1,92 @@
+#pragma once
+
+#include <infrastructure/cache_line.h>
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace rebuild {
+
+/**
+ * Bounded, lock-free single-producer/single-consumer ring buffer.
+ *
+ * Exactly one thread may push (try_emplace) and exactly one thread may pop (try_pop) at a time. The indices grow monotonically and are
+ * masked into a power of two sized slot array, the producer publishes with release and the consumer observes with acquire. Each side
+ * keeps a cached copy of the other side's index, so the shared cache lines are only touched when the cached view says full/empty.
+ *
+ * The capacity is rounded up to the next power of two (at least 1), capacity() reports the rounded value.
+ */
+template <typename T> class spsc_ring_buffer {
+  public:
+    explicit spsc_ring_buffer(std::size_t capacity) : mask_(std::bit_ceil(capacity < 1 ? 1 : capacity) - 1), slots_(new slot[mask_ + 1]) {}
+
+    ~spsc_ring_buffer() {
+        while (try_pop()) {
+        }
+    }
+
+    spsc_ring_buffer(const spsc_ring_buffer &)            = delete;
+    spsc_ring_buffer &operator=(const spsc_ring_buffer &) = delete;
+
+    // Producer side. Returns false if the buffer is full
+    template <typename... U> bool try_emplace(U &&...args) {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ > mask_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ > mask_) {
+                return false;
+            }
+        }
+        ::new (slots_[tail & mask_].storage) T(std::forward<U>(args)...);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns std::nullopt if the buffer is empty
+    std::optional<T> try_pop() {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) {
+                return std::nullopt;
+            }
+        }
+        auto             *element = std::launder(reinterpret_cast<T *>(slots_[head & mask_].storage));
+        std::optional<T> result(std::move(*element));
+        element->~T();
+        head_.store(head + 1, std::memory_order_release);
+        return result;
+    }
+
+    // Approximate when called concurrently, exact from the consumer when the producer is quiet
+    bool empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+
+    std::size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+  private:
+    struct slot {
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    // Consumer owned
+    alignas(cache_line_size) std::atomic<std::size_t> head_{0};
+    std::size_t cached_tail_{0};
+
+    // Producer owned
+    alignas(cache_line_size) std::atomic<std::size_t> tail_{0};
+    std::size_t cached_head_{0};
+
+    // Read-only after construction
+    alignas(cache_line_size) const std::size_t mask_;
+    std::unique_ptr<slot[]> slots_;
+};
+
+} // namespace rebuild
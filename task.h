@@ -0,0 +1,19 @@
+#pragma once
+
+#include <async/basic_promise.h>
+#include <async/unique_coroutine.h>
+
+namespace rebuild {
+
+/**
+ * Lazy, single owner coroutine, nothing runs until it is co_awaited (or resumed by hand).
+ *
+ *   task<int> leaf(int x) { co_return x; }
+ *   task<int> parent() { co_return co_await leaf(1) + co_await leaf(2); }
+ *
+ * The awaiting coroutine is stored in the promise and resumed from final_suspend by symmetric transfer, so arbitrarily deep or long
+ * chains of awaits run without a scheduler and without growing the stack.
+ */
+template <typename T> using task = unique_coroutine<T, promise0>;
+
+} // namespace rebuild
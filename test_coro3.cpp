@@ -1,4 +1,5 @@
 #include <asio/awaitable.hpp>
+#include <asio/bind_executor.hpp>
 #include <asio/co_spawn.hpp>
 #include <asio/detached.hpp>
 #include <asio/experimental/awaitable_operators.hpp>
@@ -6,6 +7,8 @@
 #include <asio/ip/tcp.hpp>
 #include <asio/steady_timer.hpp>
 #include <asio/use_awaitable.hpp>
+#include <algorithm>
+#include <array>
 #include <barrier>
 #include <coroutine>
 #include <nameof.hpp>
@@ -13,17 +16,34 @@
 #define DOCTEST_CONFIG_IMPLEMENT
 #include "async/asio_awaitable.h"
 #include "async/asio_concepts.h"
+#include "async/basic_promise.h"
 #include "async/coroutine_concepts.h"
 #include "async/reference_guard.h"
 #include "async/shared_coroutine.h"
+#include "async/task.h"
+#include "async/unique_coroutine.h"
 
 #include <asio.hpp>
 #include <asio/executor_work_guard.hpp>
 #include <async/sender_reciever.h>
+#include <async/setable_resume.h>
+#include <async/mpsc_channel.h>
+#include <async/spsc_channel.h>
+#include <async/timer_wheel.h>
+#include <async/use_shared_task.h>
+#include <async/when_all.h>
+#include <async/work_stealing_pool.h>
 #include <atomic>
 #include <doctest/doctest.h>
 #include <future>
+#include <latch>
+#include <memory_resource>
+#include <numeric>
+#include <infrastructure/chase_lev_deque.h>
+#include <infrastructure/frame_pool.h>
+#include <infrastructure/inplace_function.h>
 #include <infrastructure/move_only_function.h>
+#include <infrastructure/trace.h>
 #include <spdlog/spdlog.h>
 #include <thread>
 #include <vector>
@@ -57,7 +77,7 @@ SharedTask coro0(reference<asio::io_context> io) {
     co_await *std::make_shared<AwaitableAsio>(io.get());
     spdlog::info("After first resume");
 
-    [[maybe_unused]] auto h = co_await detail::GetCoroutineHandle<SharedTask::promise_type>{};
+    [[maybe_unused]] auto h = co_await ::detail::GetCoroutineHandle<SharedTask::promise_type>{};
 
     asio::steady_timer timer(io.get());
     timer.expires_after(1s);
@@ -79,6 +99,101 @@ TEST_CASE("Resume asio coro") {
     io.get().run();
 }
 
+SharedTask await_and_report(asio::io_context &io, asio::io_context &resume_on, std::atomic<bool> &on_resume_executor) {
+    co_await AsioAwaitable(io, awaitable0(), resume_on.get_executor());
+    on_resume_executor = resume_on.get_executor().running_in_this_thread();
+}
+
+TEST_CASE("asio awaitable - resumes on the given executor") {
+    asio::io_context  io;
+    std::atomic<bool> inline_resumed{false};
+    TaskHandle        same = await_and_report(io, io, inline_resumed);
+    same->try_resume();
+    io.run();
+    CHECK(same->is_done());
+    CHECK(inline_resumed);
+
+    asio::io_context  other;
+    std::atomic<bool> resumed_on_other{false};
+    TaskHandle        hop = await_and_report(io, other, resumed_on_other);
+    io.restart();
+    hop->try_resume();
+    io.run();
+    CHECK_FALSE(hop->is_done());
+    std::thread([&other] { other.run(); }).join();
+    CHECK(hop->is_done());
+    CHECK(resumed_on_other);
+}
+
+SharedTask wait_twice(asio::io_context &io, asio::error_code &ec, int &steps) {
+    asio::steady_timer timer(io, 1ms);
+    ec = co_await timer.async_wait(use_shared_task);
+    ++steps;
+    co_await asio::post(io, use_shared_task);
+    ++steps;
+}
+
+TEST_CASE("use_shared_task - await asio operations directly") {
+    asio::io_context io;
+    asio::error_code ec    = asio::error::operation_aborted;
+    int              steps = 0;
+    TaskHandle       task  = wait_twice(io, ec, steps);
+    task->try_resume();
+    CHECK_EQ(steps, 0);
+    io.run();
+    CHECK_FALSE(ec);
+    CHECK_EQ(steps, 2);
+    CHECK(task->is_done());
+}
+
+SharedTask resume_self(int &steps) {
+    auto h = co_await ::detail::GetCoroutineHandle<SharedTask::promise_type>{};
+    while (++steps < 3) {
+        // Running, so this only asks for another resumption once we suspend
+        CHECK(h.promise().shared_from_this()->resume());
+        co_await std::suspend_always{};
+    }
+}
+
+TEST_CASE("shared task - resume while running is deferred") {
+    int        steps = 0;
+    TaskHandle task  = resume_self(steps);
+    CHECK(task->try_resume());
+    CHECK_EQ(steps, 3);
+    CHECK(task->is_done());
+    CHECK_FALSE(task->resume());
+    CHECK_FALSE(task->try_resume());
+}
+
+TEST_CASE("trace ring - keeps the most recent events") {
+    auto ring   = std::make_unique<trace_ring>();
+    int  object = 0;
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&ring, &object] {
+            for (std::size_t i = 0; i < trace_ring::capacity; ++i) {
+                ring->record("event", &object);
+            }
+        });
+    }
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    // Writers lapping each other on a slot may lose events, a quiet full lap leaves exactly the last capacity events
+    for (std::size_t i = 0; i < trace_ring::capacity; ++i) {
+        ring->record(i + 1 == trace_ring::capacity ? "last" : "event", &object);
+    }
+
+    auto events = ring->snapshot();
+    REQUIRE_EQ(events.size(), trace_ring::capacity);
+    CHECK_EQ(std::string_view(events.back().what), "last");
+    CHECK_EQ(events.front().object, &object);
+
+    ring->clear();
+    CHECK(ring->snapshot().empty());
+}
+
 asio::awaitable<void> acoro0(reference<asio::io_context> io_ref) {
     spdlog::info("Hello world");
     [[maybe_unused]] auto &io = io_ref.get();
@@ -112,6 +227,329 @@ TEST_CASE("Test asio awaitables concepts") {
     CHECK(!IsAsioAwaitableFunction<decltype(coro0)>);
 }
 
+TEST_CASE("reference_guard - striped counter waits for every reference") {
+    std::atomic<bool> released{false};
+    std::thread       late;
+    {
+        int                                      object = 0;
+        reference_guard<int, striped_counter<4>> guard(object);
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 8; ++t) {
+            workers.emplace_back([&guard] {
+                for (int i = 0; i < 1000; ++i) {
+                    auto ref = guard.make_reference();
+                    CHECK(ref.alive());
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+
+        late = std::thread([ref = guard.make_reference(), &released]() mutable {
+            ref.wait_expiry();
+            std::this_thread::sleep_for(10ms);
+            released = true;
+        });
+    } // Blocks until the reference held by late is gone
+    CHECK(released);
+    late.join();
+}
+
+unique_coroutine<int, promise0> answer() { co_return 42; }
+
+unique_coroutine<int, promise0> answer_from(std::allocator_arg_t, std::pmr::memory_resource *, int x) { co_return x; }
+
+task<int> leaf(int x) { co_return x; }
+
+task<long> sum_of_leaves(int n) {
+    long sum = 0;
+    for (int i = 0; i < n; ++i) {
+        sum += co_await leaf(i);
+    }
+    co_return sum;
+}
+
+task<int> depth(int n) {
+    if (n == 0) {
+        co_return 0;
+    }
+    co_return 1 + co_await depth(n - 1);
+}
+
+TEST_CASE("task - awaits chain by symmetric transfer") {
+    // Every await completes synchronously. Optimized builds run this in constant stack, the sizes stay small enough for -O0 and ASAN
+    // builds, where gcc does not emit the transfer as a tail call
+    auto sum = sum_of_leaves(1000);
+    sum.resume();
+    CHECK(sum.is_done());
+    CHECK_EQ(sum.result(), 499500L);
+
+    auto deep = depth(1000);
+    deep.resume();
+    CHECK(deep.is_done());
+    CHECK_EQ(deep.result(), 1000);
+}
+
+// Neither default constructible nor copyable
+struct move_only_result {
+    explicit move_only_result(int v) : value(std::make_unique<int>(v)) {}
+    std::unique_ptr<int> value;
+};
+
+task<move_only_result> make_result(int v) { co_return move_only_result(v); }
+
+task<int> unwrap_result() {
+    auto result = co_await make_result(5);
+    co_return *result.value;
+}
+
+asio::awaitable<move_only_result> make_asio_result(int v) { co_return move_only_result(v); }
+
+SharedTask await_asio_result(asio::io_context &io, int &out) {
+    auto result = co_await AsioAwaitable(io, make_asio_result(9));
+    out         = *result.value;
+}
+
+TEST_CASE("move only results - task and AsioAwaitable") {
+    auto t = unwrap_result();
+    t.resume();
+    CHECK_EQ(t.result(), 5);
+
+    asio::io_context io;
+    int              out  = 0;
+    TaskHandle       task = await_asio_result(io, out);
+    task->try_resume();
+    io.run();
+    CHECK_EQ(out, 9);
+}
+
+SharedTask await_on_stopped(asio::io_context &io, asio::error_code &ec) {
+    try {
+        co_await AsioAwaitable(io, make_asio_result(9));
+    } catch (const asio::system_error &e) {
+        ec = e.code();
+    }
+}
+
+TEST_CASE("move only results - a stopped io_context fails the await instead of leaving no result") {
+    asio::io_context io;
+    io.stop();
+    asio::error_code ec;
+    TaskHandle       task = await_on_stopped(io, ec);
+    task->try_resume();
+    CHECK(task->is_done());
+    CHECK_EQ(ec, asio::error::operation_aborted);
+}
+
+task<int> fails() {
+    throw std::runtime_error("task failed");
+    co_return 0;
+}
+
+task<int> catches() {
+    try {
+        co_await fails();
+    } catch (const std::runtime_error &) {
+        co_return 1;
+    }
+    co_return 0;
+}
+
+asio::awaitable<int> asio_fails() {
+    throw std::runtime_error("asio failed");
+    co_return 0;
+}
+
+SharedTask shared_fails(asio::io_context &io, bool &caught) {
+    try {
+        co_await AsioAwaitable(io, asio_fails());
+    } catch (const std::runtime_error &) {
+        caught = true;
+    }
+    throw std::logic_error("shared task failed");
+}
+
+TEST_CASE("exceptions - rethrown where the coroutine is awaited or resumed") {
+    auto t = catches();
+    t.resume();
+    CHECK_EQ(t.result(), 1);
+
+    auto f = fails();
+    f.resume();
+    CHECK(f.is_done());
+    CHECK_THROWS_AS(f.result(), std::runtime_error);
+
+    asio::io_context io;
+    bool             caught = false;
+    TaskHandle       task   = shared_fails(io, caught);
+    task->try_resume();
+    CHECK_THROWS_AS(io.run(), std::logic_error);
+    CHECK(caught);
+    CHECK(task->is_done());
+    CHECK(task->exception());
+}
+
+#ifndef FRAME_POOL_DISABLE
+TEST_CASE("frame pool - frames are recycled") {
+    {
+        auto warm_up = answer();
+    }
+    frame_pool::reset_stats();
+    for (int i = 0; i < 100; ++i) {
+        auto c = answer();
+        c.resume();
+        CHECK(c.is_done());
+    }
+    auto stats = frame_pool::stats();
+    CHECK_EQ(stats.hits, 100);
+    CHECK_EQ(stats.misses, 0);
+}
+#endif
+
+TEST_CASE("frame pool - frame from a memory resource") {
+    std::array<std::byte, 4096>         buffer;
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+    frame_pool::reset_stats();
+    {
+        auto c = answer_from(std::allocator_arg, &arena, 7);
+        c.resume();
+        CHECK(c.is_done());
+    }
+    auto stats = frame_pool::stats();
+    CHECK_EQ(stats.hits + stats.misses, 0);
+}
+
+TEST_CASE("chase lev deque - owner pops newest, thieves steal oldest") {
+    std::array<int, 10>  items{};
+    chase_lev_deque<int> deque(2);
+    for (auto &item : items) {
+        deque.push(&item); // Grows past the initial capacity
+    }
+    CHECK_EQ(deque.steal(), &items[0]);
+    CHECK_EQ(deque.pop(), &items[9]);
+    CHECK_EQ(deque.steal(), &items[1]);
+    for (int i = 8; i >= 2; --i) {
+        CHECK_EQ(deque.pop(), &items[i]);
+    }
+    CHECK_EQ(deque.pop(), nullptr);
+    CHECK_EQ(deque.steal(), nullptr);
+    CHECK(deque.empty());
+}
+
+SharedTask hop_on(work_stealing_pool &pool, std::atomic<int> &on_pool, std::latch &finished) {
+    for (int hop = 0; hop < 10; ++hop) {
+        co_await schedule_on(pool);
+        if (pool.running_in_this_thread()) {
+            on_pool.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    finished.count_down();
+}
+
+TEST_CASE("work stealing pool - tasks hop onto the workers") {
+    constexpr int           tasks = 200;
+    std::atomic<int>        on_pool{0};
+    std::latch              finished(tasks);
+    std::vector<TaskHandle> handles;
+    {
+        work_stealing_pool pool(4);
+        CHECK_EQ(pool.size(), 4);
+        CHECK_FALSE(pool.running_in_this_thread());
+        for (int i = 0; i < tasks; ++i) {
+            handles.push_back(hop_on(pool, on_pool, finished));
+            CHECK(handles.back()->try_resume());
+        }
+        finished.wait();
+    }
+    CHECK_EQ(on_pool.load(), tasks * 10);
+    for (auto &task : handles) {
+        CHECK(task->is_done());
+    }
+}
+
+task<int>  twice(int x) { co_return 2 * x; }
+task<void> nothing() { co_return; }
+
+task<int> gather() {
+    auto [a, b, none] = co_await when_all(twice(1), twice(2), nothing());
+    static_assert(std::is_same_v<decltype(none), std::monostate>);
+    co_return a + b;
+}
+
+task<int> gather_failing() {
+    auto [a, b] = co_await when_all(twice(1), fails());
+    co_return a + b;
+}
+
+TEST_CASE("when_all - tasks") {
+    auto t = gather();
+    t.resume();
+    CHECK(t.is_done());
+    CHECK_EQ(t.result(), 6);
+
+    auto f = gather_failing();
+    f.resume();
+    CHECK(f.is_done());
+    CHECK_THROWS_AS(f.result(), std::runtime_error);
+}
+
+SharedTask sleep_then_record(asio::io_context &io, std::chrono::milliseconds duration, std::vector<int> &order, int id) {
+    asio::steady_timer timer(io, duration);
+    co_await timer.async_wait(use_shared_task);
+    order.push_back(id);
+}
+
+SharedTask race_then_join(asio::io_context &io, std::vector<int> &order, std::size_t &first) {
+    first = co_await when_any(sleep_then_record(io, 100ms, order, 1), sleep_then_record(io, 1ms, order, 2));
+    co_await when_all(sleep_then_record(io, 20ms, order, 3), sleep_then_record(io, 1ms, order, 4));
+}
+
+TEST_CASE("when_all / when_any - shared tasks") {
+    asio::io_context io;
+    std::vector<int> order;
+    std::size_t      first = 0;
+    TaskHandle       task  = race_then_join(io, order, first);
+    task->try_resume();
+    io.run();
+    CHECK(task->is_done());
+    CHECK_EQ(first, 1);
+    // The loser of when_any is not cancelled, it finishes on its own
+    CHECK_EQ(order, (std::vector<int>{2, 4, 3, 1}));
+}
+
+SharedTask add_on(work_stealing_pool &pool, std::atomic<int> &sum, int value) {
+    co_await schedule_on(pool);
+    sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+SharedTask fan_out(work_stealing_pool &pool, std::atomic<int> &sum, std::latch &finished) {
+    co_await when_all(add_on(pool, sum, 1), add_on(pool, sum, 2), add_on(pool, sum, 3));
+    auto first = co_await when_any(add_on(pool, sum, 1), add_on(pool, sum, 2), add_on(pool, sum, 3));
+    CHECK_LT(first, 3);
+    finished.count_down();
+}
+
+TEST_CASE("when_all / when_any - children finish on other threads") {
+    constexpr int           tasks = 100;
+    std::atomic<int>        sum{0};
+    std::latch              finished(tasks);
+    std::vector<TaskHandle> handles;
+    {
+        work_stealing_pool pool(4);
+        for (int i = 0; i < tasks; ++i) {
+            handles.push_back(fan_out(pool, sum, finished));
+            handles.back()->try_resume();
+        }
+        finished.wait();
+    }
+    CHECK_EQ(sum.load(), tasks * 12);
+    for (auto &task : handles) {
+        CHECK(task->is_done());
+    }
+}
+
 template <typename Reciever> asio::awaitable<void> resume_coro0(Reciever handle, int expected = 2) {
     auto exec = co_await asio::this_coro::executor;
 
@@ -207,6 +645,949 @@ TEST_CASE("multi arg resume") {
     CHECK(!s.send(7, ""));
 }
 
+asio::awaitable<void> wait_resumes(setable_resume<void(int)> &r, int n, std::vector<int> &seen, std::vector<std::thread::id> &threads) {
+    auto setter = r.weak_ptr().lock();
+    for (int i = 0; i < n; ++i) {
+        auto value = co_await asio::async_compose<decltype(asio::use_awaitable), void(int)>(
+            [&setter](auto &&self) { (*setter)(std::forward<decltype(self)>(self)); }, asio::use_awaitable);
+        seen.push_back(value);
+        threads.push_back(std::this_thread::get_id());
+    }
+}
+
+TEST_CASE("setable_resume - resumed before the waiter arms") {
+    asio::io_context             io;
+    setable_resume<void(int)>    r;
+    std::vector<int>             seen;
+    std::vector<std::thread::id> threads;
+
+    r.resume(1); // Kept in the slot until the handler arrives
+    CHECK_FALSE(r.is_set());
+    asio::co_spawn(io, wait_resumes(r, 2, seen, threads), asio::detached);
+    io.poll();
+    CHECK_EQ(seen, (std::vector<int>{1}));
+    CHECK(r.is_set());
+    r.resume(2);
+    io.poll();
+    CHECK_EQ(seen, (std::vector<int>{1, 2}));
+}
+
+TEST_CASE("setable_resume - the waiter arms again from inside the completion") {
+    asio::io_context             io;
+    setable_resume<void(int)>    r;
+    std::vector<int>             seen;
+    std::vector<std::thread::id> threads;
+
+    asio::co_spawn(io, wait_resumes(r, 3, seen, threads), asio::detached);
+    io.poll();
+    // On the io thread the coroutine runs on inside resume() and arms the next wait before resume() returns
+    asio::post(io, [&r] {
+        for (int i = 0; i < 3; ++i) {
+            REQUIRE(r.is_set());
+            r.resume(std::move(i));
+        }
+    });
+    io.poll();
+    CHECK_EQ(seen, (std::vector<int>{0, 1, 2}));
+}
+
+TEST_CASE("setable_resume - resumed from a foreign thread, completes on the io thread") {
+    asio::io_context             io;
+    setable_resume<void(int)>    r;
+    constexpr int                n = 1000;
+    std::vector<int>             seen;
+    std::vector<std::thread::id> threads;
+
+    asio::co_spawn(io, wait_resumes(r, n, seen, threads), asio::detached);
+    std::thread callbacks([&r] {
+        // One resume per wait. The first may come before the waiter is armed, the slot keeps it
+        for (int i = 0; i < n; ++i) {
+            while (i > 0 && !r.is_set()) {
+                std::this_thread::yield();
+            }
+            r.resume(std::move(i));
+        }
+    });
+
+    auto work = asio::make_work_guard(io);
+    while (seen.size() < n) {
+        io.run_one();
+    }
+    callbacks.join();
+
+    std::vector<int> expected(n);
+    std::iota(expected.begin(), expected.end(), 0);
+    CHECK_EQ(seen, expected);
+    CHECK(std::all_of(threads.begin(), threads.end(), [](auto id) { return id == std::this_thread::get_id(); }));
+}
+
+template <typename Reciever> asio::awaitable<int> count_in_order(Reciever handle, int n) {
+    auto exec     = co_await asio::this_coro::executor;
+    int  in_order = 0;
+    for (int j = 0; j < n; ++j) {
+        auto i = co_await awaitable_resumption(handle, exec);
+        in_order += (i == j);
+    }
+    co_return in_order;
+}
+
+template <typename Reciever> asio::awaitable<void> receive_until_closed(Reciever handle, std::vector<int> &seen, bool &ended) {
+    auto exec = co_await asio::this_coro::executor;
+    for (;;) {
+        auto value = co_await awaitable_receive(handle, exec);
+        if (!value) {
+            break;
+        }
+        seen.push_back(*value);
+    }
+    ended = true;
+}
+
+TEST_CASE("close - receive drains the queue, then reports the end of the stream") {
+    asio::io_context io;
+    std::vector<int> seen;
+    bool             ended = false;
+
+    auto [s, r] = make_sender_reciever_pair<int>();
+    s.send(1);
+    s.send(2);
+    asio::co_spawn(io, receive_until_closed(std::move(r), seen, ended), asio::detached);
+    io.poll();
+    CHECK_EQ(seen, (std::vector<int>{1, 2}));
+    CHECK_FALSE(ended);
+
+    // The parked receive is woken by the close itself, nothing throws
+    s.send(3);
+    s.close();
+    io.poll();
+    CHECK_EQ(seen, (std::vector<int>{1, 2, 3}));
+    CHECK(ended);
+}
+
+TEST_CASE("close - the reciever stops the senders and still drains") {
+    asio::io_context io;
+    std::vector<int> seen;
+    bool             ended = false;
+    int              sent  = -1;
+
+    auto [s, r] = make_sender_reciever_pair<int>(2);
+    s.send(1);
+    s.send(2);
+    s.async_send(asio::bind_executor(io, [&sent](bool ok) { sent = ok; }), 3); // Blocked, the channel is full
+    r.close();
+    io.poll();
+    CHECK_EQ(sent, 0);
+    CHECK_EQ(s.try_send(4), send_result::closed);
+    CHECK(r.is_closed());
+
+    io.restart();
+    asio::co_spawn(io, receive_until_closed(std::move(r), seen, ended), asio::detached);
+    io.run();
+    CHECK_EQ(seen, (std::vector<int>{1, 2}));
+    CHECK(ended);
+}
+
+template <typename Reciever> asio::awaitable<void> wait_on_closing(Reciever handle, std::optional<int> &timed, std::size_t &batched) {
+    auto               exec = co_await asio::this_coro::executor;
+    std::array<int, 4> batch{};
+    timed   = co_await awaitable_receive_for(handle, 10s, exec);
+    batched = co_await awaitable_receive_batch(handle, std::span<int>(batch), exec);
+}
+
+TEST_CASE("close - timed and batch receives end without a value") {
+    asio::io_context   io;
+    std::optional<int> timed = 1;
+    std::size_t        batched = 1;
+
+    auto [s, r] = make_sender_reciever_pair<int>();
+    asio::co_spawn(io, wait_on_closing(std::move(r), timed, batched), asio::detached);
+    io.poll();
+    s.close();
+    io.run(); // The deadline left the wheel with the close, nothing waits for it
+    CHECK_FALSE(timed);
+    CHECK_EQ(batched, 0);
+}
+
+template <typename Reciever>
+asio::awaitable<void> resume_once(Reciever handle, bool &resumed, [[maybe_unused]] std::shared_ptr<int> frame_alive) {
+    auto exec = co_await asio::this_coro::executor;
+    co_await awaitable_resumption(handle, exec);
+    resumed = true;
+}
+
+TEST_CASE("close - a parked resumption is dropped, nothing stands in for the value") {
+    asio::io_context   io;
+    bool               resumed = false;
+    auto               frame   = std::make_shared<int>(0);
+    std::weak_ptr<int> watch   = frame;
+
+    auto [s, r] = make_sender_reciever_pair<int>();
+    asio::co_spawn(io, resume_once(std::move(r), resumed, std::move(frame)), asio::detached);
+    io.poll();
+    CHECK_FALSE(watch.expired());
+
+    s.close();
+    io.poll();
+    CHECK_FALSE(resumed);
+    CHECK(watch.expired());
+}
+
+TEST_CASE("spsc channel - close ends the stream across threads") {
+    asio::io_context io;
+    constexpr int    n     = 10000;
+    std::vector<int> seen;
+    bool             ended = false;
+
+    auto [s, r] = make_spsc_sender_reciever_pair<int>(64);
+    asio::co_spawn(io, receive_until_closed(std::move(r), seen, ended), asio::detached);
+
+    std::thread producer([s = std::move(s)]() mutable {
+        for (int i = 0; i < n;) {
+            if (s.send(i)) {
+                ++i;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        s.close();
+    });
+
+    io.run();
+    producer.join();
+    CHECK_EQ(seen.size(), n);
+    CHECK(ended);
+}
+
+TEST_CASE("spsc channel - producer thread") {
+    asio::io_context io;
+    constexpr int    n = 100000;
+
+    auto [s, r] = make_spsc_sender_reciever_pair<int>(64);
+    auto fut = asio::co_spawn(io, count_in_order(std::move(r), n), asio::use_future);
+
+    std::thread producer([s = std::move(s)]() mutable {
+        for (int i = 0; i < n;) {
+            if (s.send(i)) {
+                ++i;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    io.run();
+    producer.join();
+    CHECK_EQ(fut.get(), n);
+}
+
+TEST_CASE("spsc ring buffer - wrap around") {
+    rebuild::spsc_ring_buffer<std::string> ring(3);
+    REQUIRE_EQ(ring.capacity(), 4);
+    for (int lap = 0; lap < 3; ++lap) {
+        for (int i = 0; i < 4; ++i) {
+            CHECK(ring.try_emplace(std::to_string(i)));
+        }
+        CHECK(!ring.try_emplace("full"));
+        for (int i = 0; i < 4; ++i) {
+            CHECK_EQ(ring.try_pop(), std::to_string(i));
+        }
+        CHECK(!ring.try_pop());
+    }
+}
+
+TEST_CASE("spsc channel - capacity is rounded up to a power of two") {
+    CHECK_EQ(spsc_holder<int>::make_holder(0)->capacity(), 1);
+    CHECK_EQ(spsc_holder<int>::make_holder(5)->capacity(), 8);
+    CHECK_EQ(spsc_holder<int>::make_holder(64)->capacity(), 64);
+
+    auto [s, r] = make_spsc_sender_reciever_pair<int>(5);
+    for (int i = 0; i < 8; ++i) {
+        CHECK(s.send(i));
+    }
+    CHECK(!s.send(8));
+}
+
+// Ends with the stream, once every sender is gone (or a reciever closed the channel) and the values are drained
+template <typename Reciever> asio::awaitable<void> sum_until_closed(Reciever handle, std::atomic<long> &sum, std::atomic<int> &count) {
+    auto exec = co_await asio::this_coro::executor;
+    for (;;) {
+        auto i = co_await awaitable_receive(handle, exec);
+        if (!i) {
+            break;
+        }
+        sum.fetch_add(*i, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+template <typename Reciever> asio::awaitable<long> sum_n(Reciever handle, int n) {
+    auto exec = co_await asio::this_coro::executor;
+    long sum  = 0;
+    for (int j = 0; j < n; ++j) {
+        sum += co_await awaitable_resumption(handle, exec);
+    }
+    co_return sum;
+}
+
+TEST_CASE("mpsc channel - fan in from many threads") {
+    asio::io_context io;
+    constexpr int    n_threads = 4;
+    constexpr int    n         = 20000;
+
+    auto [s, r] = make_mpsc_sender_reciever_pair<int>();
+    auto fut    = asio::co_spawn(io, sum_n(std::move(r), n_threads * n), asio::use_future);
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < n_threads; ++t) {
+        producers.emplace_back([sender = s /* one sender per thread */]() mutable {
+            for (int i = 0; i < n; ++i) {
+                sender.send(i);
+            }
+        });
+    }
+
+    io.run();
+    for (auto &t : producers) {
+        t.join();
+    }
+    CHECK_EQ(fut.get(), n_threads * (static_cast<long>(n) * (n - 1) / 2));
+}
+
+TEST_CASE("mpmc channel - competing recievers") {
+    asio::io_context  io;
+    constexpr int     n = 10000;
+    std::atomic<long> sum{0};
+    std::atomic<int>  count{0};
+
+    auto [s, r] = make_mpmc_sender_reciever_pair<int>();
+    for (int j = 0; j < 3; ++j) {
+        asio::co_spawn(io, sum_until_closed(mpmc_reciever<int>(r), sum, count), asio::detached);
+    }
+    { auto last = std::move(r); }
+
+    std::thread producer0([sender = s]() mutable {
+        for (int i = 0; i < n; ++i) {
+            sender.send(i);
+        }
+    });
+    std::thread producer1([s = std::move(s)]() mutable {
+        for (int i = 0; i < n; ++i) {
+            s.send(i);
+        }
+    });
+
+    std::thread io_thread([&io] { io.run(); });
+    io.run();
+    producer0.join();
+    producer1.join();
+    io_thread.join();
+
+    CHECK_EQ(count.load(), 2 * n);
+    CHECK_EQ(sum.load(), 2 * (static_cast<long>(n) * (n - 1) / 2));
+}
+
+TEST_CASE("mpmc channel - close ends the stream for every reciever") {
+    asio::io_context io;
+    std::vector<int> first_seen, second_seen;
+    bool             first_ended = false, second_ended = false;
+
+    auto [s, r] = make_mpmc_sender_reciever_pair<int>();
+    asio::co_spawn(io, receive_until_closed(mpmc_reciever<int>(r), first_seen, first_ended), asio::detached);
+    asio::co_spawn(io, receive_until_closed(mpmc_reciever<int>(r), second_seen, second_ended), asio::detached);
+    io.poll();
+    CHECK(s.send(7)); // Goes to the oldest waiter, which parks again behind the other one
+    io.poll();
+    CHECK_EQ(first_seen, (std::vector<int>{7}));
+    CHECK_FALSE(first_ended);
+
+    r.close();
+    CHECK(r.is_closed());
+    CHECK_EQ(s.try_send(8), send_result::closed);
+    io.poll();
+    CHECK(first_ended);
+    CHECK(second_ended);
+    CHECK(second_seen.empty());
+}
+
+asio::awaitable<void> produce_n(sender<int> s, int n, int &produced) {
+    for (int i = 0; i < n; ++i) {
+        CHECK(co_await awaitable_send(s, i));
+        ++produced;
+    }
+}
+
+TEST_CASE("bounded channel - async_send suspends while full") {
+    asio::io_context io;
+    int              produced = 0;
+
+    auto [s, r] = make_sender_reciever_pair<int>(2);
+    asio::co_spawn(io, produce_n(std::move(s), 10, produced), asio::detached);
+    io.poll();
+    CHECK_EQ(produced, 2);
+
+    auto fut = asio::co_spawn(io, sum_n(std::move(r), 10), asio::use_future);
+    io.run();
+    CHECK_EQ(produced, 10);
+    CHECK_EQ(fut.get(), 45);
+}
+
+TEST_CASE("bounded channel - try_send") {
+    auto [s, r] = make_sender_reciever_pair<int>(1);
+    CHECK(s.try_send(1) == send_result::sent);
+    CHECK(s.try_send(2) == send_result::full);
+    CHECK(!s.send(3));
+    { auto gone = std::move(r); }
+    CHECK(s.try_send(4) == send_result::closed);
+}
+
+TEST_CASE("bounded channel - capacity 0 is a rendezvous") {
+    asio::io_context io;
+    int              produced = 0;
+
+    auto [s, r] = make_sender_reciever_pair<int>(0);
+    CHECK(s.try_send(1) == send_result::full);
+    asio::co_spawn(io, produce_n(std::move(s), 3, produced), asio::detached);
+    io.poll();
+    CHECK_EQ(produced, 0);
+
+    auto fut = asio::co_spawn(io, sum_n(std::move(r), 3), asio::use_future);
+    io.run();
+    CHECK_EQ(produced, 3);
+    CHECK_EQ(fut.get(), 3);
+}
+
+template <typename Reciever>
+asio::awaitable<void> receive_in_batches(Reciever handle, std::vector<int> &seen, std::vector<std::size_t> &sizes) {
+    auto               exec = co_await asio::this_coro::executor;
+    std::array<int, 4> batch{};
+    while (seen.size() < 10) {
+        auto n = co_await awaitable_receive_batch(handle, std::span<int>(batch), exec);
+        seen.insert(seen.end(), batch.begin(), batch.begin() + static_cast<std::ptrdiff_t>(n));
+        sizes.push_back(n);
+    }
+}
+
+TEST_CASE("batch send and receive") {
+    asio::io_context         io;
+    std::vector<int>         seen;
+    std::vector<std::size_t> sizes;
+
+    auto [s, r] = make_sender_reciever_pair<int>();
+    asio::co_spawn(io, receive_in_batches(std::move(r), seen, sizes), asio::detached);
+    io.poll();
+
+    // The parked reciever gets the first value, the rest queue up and ride along in the same resumption
+    const std::vector<int> values{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    CHECK_EQ(s.send_bulk(values), 10);
+    io.run();
+    CHECK_EQ(sizes, (std::vector<std::size_t>{4, 4, 2}));
+    CHECK_EQ(seen, values);
+}
+
+TEST_CASE("batch send - stops at the first rejected value") {
+    auto [s, r] = make_sender_reciever_pair<int, std::string>(3);
+    std::vector<std::tuple<int, std::string>> values{{1, "a"}, {2, "b"}, {3, "c"}, {4, "d"}};
+    CHECK_EQ(s.send_bulk(values), 3);
+    CHECK_EQ(std::get<1>(values[0]), "a");
+}
+
+TEST_CASE("spsc channel - batch receive from producer thread") {
+    asio::io_context         io;
+    std::vector<int>         seen;
+    std::vector<std::size_t> sizes;
+
+    auto [s, r] = make_spsc_sender_reciever_pair<int>(16);
+    asio::co_spawn(io, receive_in_batches(std::move(r), seen, sizes), asio::detached);
+
+    std::thread producer([s = std::move(s)]() mutable {
+        std::vector<int> values{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+        CHECK_EQ(s.send_bulk(values), 10);
+    });
+    io.run();
+    producer.join();
+    CHECK_EQ(seen, (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+template <typename T> struct counting_allocator {
+    using value_type = T;
+
+    counting_allocator(int &live) : live_(&live) {}
+    template <typename U> counting_allocator(const counting_allocator<U> &other) : live_(other.live_) {}
+
+    T *allocate(std::size_t n) {
+        ++*live_;
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T *p, std::size_t n) {
+        --*live_;
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    bool operator==(const counting_allocator &) const = default;
+
+    int *live_;
+};
+
+TEST_CASE("parked completion - storage comes from the given allocator") {
+    int  live             = 0;
+    int  live_during_call = -1;
+    auto f                = async::detail::parked_completion([&live, &live_during_call] { live_during_call = live; },
+                                                             counting_allocator<void>(live));
+    CHECK_EQ(live, 1);
+
+    f();
+    CHECK_FALSE(f);
+    CHECK_EQ(live_during_call, 0); // released before the call, like asio handlers
+    CHECK_EQ(live, 0);
+
+    f = async::detail::parked_completion([] {}, counting_allocator<void>(live));
+    f = nullptr;
+    CHECK_EQ(live, 0);
+}
+
+TEST_CASE("move_only_function - inline and heap stored callables") {
+    auto token = std::make_shared<int>(1);
+
+    rebuild::move_only_function<int(int)> small = [p = std::make_unique<int>(2)](int x) { return x * *p; };
+    rebuild::move_only_function<int(int)> large = [big = std::array<long, 32>{3}, token](int x) { return x * static_cast<int>(big[0]); };
+    CHECK_EQ(small(5), 10);
+    CHECK_EQ(large(5), 15);
+    CHECK_EQ(token.use_count(), 2);
+
+    small.swap(large);
+    CHECK_EQ(small(1), 3);
+    CHECK_EQ(large(1), 2);
+
+    auto moved = std::move(small);
+    CHECK_FALSE(small);
+    CHECK_EQ(moved(2), 6);
+
+    moved = nullptr;
+    CHECK_EQ(token.use_count(), 1);
+}
+
+template <typename Reciever> asio::awaitable<void> store_one(Reciever handle, int &received) {
+    auto exec = co_await asio::this_coro::executor;
+    received  = co_await awaitable_resumption(handle, exec);
+}
+
+TEST_CASE("direct handoff - reciever resumes inside send") {
+    asio::io_context io;
+    int              received = -1;
+
+    auto [s, r] = make_sender_reciever_pair<int>(unbounded, handoff::direct);
+    asio::co_spawn(io, store_one(std::move(r), received), asio::detached);
+    io.poll();
+
+    asio::post(io, [&s, &received] {
+        CHECK(s.send(7));
+        CHECK_EQ(received, 7);
+    });
+    io.run();
+}
+
+template <typename Reciever, typename Sender> asio::awaitable<int> bounce(Reciever handle, Sender out, int n) {
+    auto exec = co_await asio::this_coro::executor;
+    int  x    = 0;
+    while (x < n) {
+        x = co_await awaitable_resumption(handle, exec);
+        out(x + 1);
+    }
+    co_return x;
+}
+
+TEST_CASE("direct handoff - ping pong keeps the stack bounded") {
+    asio::io_context io;
+    constexpr int    n = 100000;
+
+    auto [s1, r1] = make_sender_reciever_pair<int>(unbounded, handoff::direct);
+    auto [s2, r2] = make_sender_reciever_pair<int>(unbounded, handoff::direct);
+    REQUIRE(s1.send(0));
+    auto first  = asio::co_spawn(io, bounce(std::move(r1), std::move(s2), n), asio::use_future);
+    auto second = asio::co_spawn(io, bounce(std::move(r2), std::move(s1), n), asio::use_future);
+    io.run();
+    CHECK_GE(first.get(), n);
+    CHECK_GE(second.get(), n);
+}
+
+namespace {
+// Every allocation of the test binary, like the counters in bench_coro.cpp
+std::atomic<std::size_t> allocations{0};
+
+// Out of line, inlined into a delete expression gcc sees free() on a pointer from operator new (-Wmismatched-new-delete)
+[[gnu::noinline]] void counted_free(void *p) noexcept { std::free(p); }
+} // namespace
+
+// The array and nothrow forms forward to these
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete(void *p, std::size_t) noexcept { counted_free(p); }
+
+// As bounce, and counts the allocations from the warm_up-th value on
+template <typename Reciever, typename Sender>
+asio::awaitable<void> counted_bounce(Reciever handle, Sender out, int warm_up, int n, std::size_t &allocated) {
+    auto        exec  = co_await asio::this_coro::executor;
+    std::size_t start = 0;
+    for (int i = 0; i < n; ++i) {
+        if (i == warm_up) {
+            start = allocations.load(std::memory_order_relaxed);
+        }
+        auto x = co_await awaitable_resumption(handle, exec);
+        out(x + 1);
+    }
+    allocated = allocations.load(std::memory_order_relaxed) - start;
+}
+
+TEST_CASE("ping pong - no allocation per message once warmed up") {
+    asio::io_context io;
+    constexpr int    warm_up   = 100;
+    constexpr int    n         = 10000;
+    std::size_t      allocated = 1;
+
+    auto [s1, r1] = make_sender_reciever_pair<int>();
+    auto [s2, r2] = make_sender_reciever_pair<int>();
+    REQUIRE(s1.send(0));
+    asio::co_spawn(io, counted_bounce(std::move(r1), std::move(s2), warm_up, n, allocated), asio::detached);
+    asio::co_spawn(io, bounce(std::move(r2), std::move(s1), 2 * n - 1), asio::detached);
+    io.run();
+    CHECK_EQ(allocated, 0);
+}
+
+template <typename Numbers, typename Words>
+asio::awaitable<void> select_three(Numbers numbers, Words words, std::vector<std::string> &seen) {
+    auto exec = co_await asio::this_coro::executor;
+    for (int i = 0; i < 3; ++i) {
+        auto [index, value] = co_await awaitable_receive_any(exec, numbers, words);
+        if (index == 0) {
+            seen.push_back(std::to_string(std::get<0>(value)));
+        } else {
+            seen.push_back(std::get<1>(value));
+        }
+    }
+}
+
+TEST_CASE("receive_any - first channel to deliver wins, the others keep their values") {
+    asio::io_context         io;
+    std::vector<std::string> seen;
+
+    auto [numbers, numbers_reciever] = make_sender_reciever_pair<int>();
+    auto [words, words_reciever]     = make_sender_reciever_pair<std::string>();
+    CHECK(words.send("queued"));
+    asio::co_spawn(io, select_three(std::move(numbers_reciever), std::move(words_reciever), seen), asio::detached);
+    io.poll();
+    CHECK_EQ(seen, (std::vector<std::string>{"queued"}));
+
+    // Parked on both channels, the first send wins and withdraws the other branch, so the second send is queued and not lost
+    CHECK(numbers.send(1));
+    CHECK(words.send("later"));
+    io.run();
+    CHECK_EQ(seen, (std::vector<std::string>{"queued", "1", "later"}));
+}
+
+template <typename Numbers, typename Words>
+asio::awaitable<void> select_until_closed(Numbers numbers, Words words, std::vector<std::size_t> &indices) {
+    auto exec = co_await asio::this_coro::executor;
+    for (;;) {
+        auto [index, value] = co_await awaitable_receive_any(exec, numbers, words);
+        indices.push_back(index);
+        if (index == 2) {
+            CHECK(std::holds_alternative<std::monostate>(value));
+            co_return;
+        }
+    }
+}
+
+TEST_CASE("receive_any - ends with index sizeof...(channels) once every channel is closed") {
+    asio::io_context         io;
+    std::vector<std::size_t> indices;
+
+    // Parked on both, a close only ends its own branch until the last open channel closes too
+    auto [numbers, numbers_reciever] = make_sender_reciever_pair<int>();
+    auto [words, words_reciever]     = make_sender_reciever_pair<std::string>();
+    asio::co_spawn(io, select_until_closed(std::move(numbers_reciever), std::move(words_reciever), indices), asio::detached);
+    io.poll();
+    words.close();
+    io.poll();
+    CHECK(indices.empty());
+    CHECK(numbers.send(1));
+    io.poll();
+    numbers.close();
+    io.poll();
+    CHECK_EQ(indices, (std::vector<std::size_t>{0, 2}));
+
+    // Closed before the select, the queued value comes first and then it completes right away
+    indices.clear();
+    io.restart();
+    auto [closed_numbers, closed_numbers_reciever] = make_sender_reciever_pair<int>();
+    auto [closed_words, closed_words_reciever]     = make_sender_reciever_pair<std::string>();
+    CHECK(closed_words.send("last"));
+    closed_numbers.close();
+    closed_words.close();
+    asio::co_spawn(io, select_until_closed(std::move(closed_numbers_reciever), std::move(closed_words_reciever), indices),
+                   asio::detached);
+    io.poll();
+    CHECK_EQ(indices, (std::vector<std::size_t>{1, 2}));
+}
+
+struct recorded_expiry : timer_wheel::entry {
+    recorded_expiry(std::vector<int> &order, int id) : timer_wheel::entry{&recorded_expiry::record}, order(order), id(id) {}
+
+    static void record(timer_wheel::entry *e) {
+        auto *self = static_cast<recorded_expiry *>(e);
+        self->order.push_back(self->id);
+    }
+
+    std::vector<int> &order;
+    int               id;
+};
+
+TEST_CASE("timer wheel - expires in deadline order across levels") {
+    asio::io_context io;
+    auto             wheel = timer_wheel::for_executor(io.get_executor());
+    CHECK_EQ(wheel, timer_wheel::for_executor(io.get_executor()));
+
+    std::vector<int> order;
+    recorded_expiry  late(order, 3), soon(order, 1), cancelled(order, 4), middle(order, 2);
+    auto             now = timer_wheel::clock::now();
+    wheel->insert(late, now + 130ms); // Level 1, cascades down twice
+    wheel->insert(soon, now + 2ms);
+    wheel->insert(cancelled, now + 5ms);
+    wheel->insert(middle, now + 70ms);
+    wheel->cancel(cancelled);
+    CHECK_EQ(wheel->size(), 3);
+    io.run();
+    CHECK_EQ(order, (std::vector<int>{1, 2, 3}));
+    CHECK_EQ(wheel->size(), 0);
+}
+
+template <typename Reciever> asio::awaitable<void> receive_twice_for(Reciever handle, std::vector<std::optional<int>> &results) {
+    auto exec = co_await asio::this_coro::executor;
+    results.push_back(co_await awaitable_receive_for(handle, 5ms, exec));
+    results.push_back(co_await awaitable_receive_for(handle, 10s, exec));
+}
+
+TEST_CASE("receive_for - empty on timeout, the value otherwise") {
+    asio::io_context                io;
+    std::vector<std::optional<int>> results;
+
+    auto [s, r] = make_sender_reciever_pair<int>();
+    asio::co_spawn(io, receive_twice_for(std::move(r), results), asio::detached);
+    io.run_one(); // Parked with a deadline
+    io.run_one(); // Timed out
+    io.poll();    // Parked again
+    CHECK_EQ(results.size(), 1);
+    CHECK(s.send(3));
+    io.run();
+    CHECK_EQ(results, (std::vector<std::optional<int>>{std::nullopt, 3}));
+    // The second deadline was taken out of the wheel with the value, nothing keeps the io_context running
+    CHECK_EQ(timer_wheel::for_executor(io.get_executor())->size(), 0);
+}
+
+asio::awaitable<void> sleep_awaitable(std::vector<int> &order) {
+    auto exec = co_await asio::this_coro::executor;
+    co_await sleep_for(20ms, asio::use_awaitable, exec);
+    order.push_back(2);
+}
+
+SharedTask sleep_task(asio::io_context &io, std::vector<int> &order, asio::error_code &ec) {
+    ec = co_await sleep_for(5ms, use_shared_task, io.get_executor());
+    order.push_back(1);
+}
+
+TEST_CASE("sleep_for - from asio::awaitable and SharedTask on one wheel") {
+    asio::io_context io;
+    std::vector<int> order;
+    asio::error_code ec = asio::error::operation_aborted;
+
+    auto start = timer_wheel::clock::now();
+    asio::co_spawn(io, sleep_awaitable(order), asio::detached);
+    TaskHandle task = sleep_task(io, order, ec);
+    task->try_resume();
+    io.run();
+    CHECK_EQ(order, (std::vector<int>{1, 2}));
+    CHECK_FALSE(ec);
+    CHECK(timer_wheel::clock::now() - start >= 20ms);
+    CHECK(task->is_done());
+}
+
+asio::awaitable<void> sleep_repeatedly(int times, std::atomic<int> &done) {
+    auto exec = co_await asio::this_coro::executor;
+    for (int i = 0; i < times; ++i) {
+        co_await sleep_for(std::chrono::milliseconds(i % 3), asio::use_awaitable, exec);
+    }
+    ++done;
+}
+
+TEST_CASE("sleep_for - an io_context run from several threads shares its wheel") {
+    asio::io_context io;
+    std::atomic<int> done{0};
+    constexpr int    sleepers = 32;
+
+    for (int i = 0; i < sleepers; ++i) {
+        asio::co_spawn(io, sleep_repeatedly(20, done), asio::detached);
+    }
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&io] { io.run(); });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    CHECK_EQ(done, sleepers);
+    CHECK_EQ(timer_wheel::for_executor(io.get_executor())->size(), 0);
+}
+
+asio::awaitable<void> sleep_forever([[maybe_unused]] std::shared_ptr<int> frame_alive) {
+    auto exec = co_await asio::this_coro::executor;
+    co_await sleep_for(1h, asio::use_awaitable, exec);
+}
+
+TEST_CASE("sleep_for - pending sleeps are destroyed with the io_context") {
+    auto               frame = std::make_shared<int>(0);
+    std::weak_ptr<int> watch = frame;
+    {
+        asio::io_context io;
+        asio::co_spawn(io, sleep_forever(std::move(frame)), asio::detached);
+        io.poll();
+        CHECK_FALSE(watch.expired());
+    }
+    CHECK(watch.expired());
+}
+
+TEST_CASE("inplace_function - fixed storage") {
+    auto token = std::make_shared<int>(4);
+
+    rebuild::inplace_function<int(int), 32> f = [token](int x) { return x + *token; };
+    static_assert(sizeof(f) <= 32 + alignof(std::max_align_t));
+    static_assert(std::is_nothrow_move_constructible_v<decltype(f)> && std::is_nothrow_move_assignable_v<decltype(f)>);
+    CHECK_EQ(f(1), 5);
+
+    auto g = std::move(f);
+    CHECK_FALSE(f);
+    CHECK_EQ(g(2), 6);
+
+    g = nullptr;
+    CHECK_EQ(token.use_count(), 1);
+}
+
+TEST_CASE("inplace_function - as the holder completion") {
+    using inplace_holder = basic_holder<rebuild::inplace_function<void(), 512>, int>;
+    asio::io_context io;
+    int              received = -1;
+
+    auto                         h = inplace_holder::make_holder();
+    basic_sender<inplace_holder> s(h);
+    asio::co_spawn(io, store_one(basic_reciever<inplace_holder>(h), received), asio::detached);
+    io.poll();
+
+    CHECK(s.send(3));
+    io.run();
+    CHECK_EQ(received, 3);
+}
+
+asio::awaitable<void> park_until_received(reciever<int> r, [[maybe_unused]] std::shared_ptr<int> frame_alive) {
+    auto exec = co_await asio::this_coro::executor;
+    co_await awaitable_resumption(r, exec);
+}
+
+TEST_CASE("Test cancellation - a parked reciever completes at once") {
+    asio::io_context io;
+
+    auto                      sender  = make_sender<int>();
+    auto                      frame   = std::make_shared<int>(0);
+    std::weak_ptr<int>        watch   = frame;
+    bool                      aborted = false;
+    asio::cancellation_signal cancel_signal;
+    asio::co_spawn(io, park_until_received(sender.make_reciever(), std::move(frame)),
+                   asio::bind_cancellation_slot(cancel_signal.slot(), [&aborted](std::exception_ptr e) {
+                       try {
+                           if (e) {
+                               std::rethrow_exception(e);
+                           }
+                       } catch (const asio::system_error &error) {
+                           aborted = error.code() == asio::error::operation_aborted;
+                       }
+                   }));
+    io.poll();
+    CHECK_FALSE(watch.expired());
+
+    // The parked resumption throws operation_aborted and the coroutine finishes, long before the sender dies. No value is made up
+    cancel_signal.emit(asio::cancellation_type::terminal);
+    io.poll();
+    CHECK(aborted);
+    CHECK(watch.expired());
+    CHECK_FALSE(sender.has_reciever());
+}
+
+asio::awaitable<void> resumption_or_timeout(reciever<int> r, std::size_t &winner) {
+    using namespace asio::experimental::awaitable_operators;
+    auto               exec = co_await asio::this_coro::executor;
+    asio::steady_timer timer(exec, 10ms);
+    auto               result = co_await (awaitable_resumption(r, exec) || timer.async_wait(asio::use_awaitable));
+    winner                    = result.index();
+}
+
+TEST_CASE("Test cancellation - resumption || timer completes when the timer wins") {
+    asio::io_context io;
+    auto             sender = make_sender<int>();
+    std::size_t      winner = 0;
+    asio::co_spawn(io, resumption_or_timeout(sender.make_reciever(), winner), asio::detached);
+
+    // || waits for the cancelled resumption as well, the io_context only runs out of work once it has completed
+    io.run_for(1s);
+    CHECK(io.stopped());
+    CHECK_EQ(winner, 1);
+}
+
+asio::awaitable<void> receive_for_until_cancelled(reciever<int> r, std::optional<int> &result, bool &done) {
+    auto exec = co_await asio::this_coro::executor;
+    result    = co_await awaitable_receive_for(r, 1h, exec);
+    done      = true;
+}
+
+TEST_CASE("Test cancellation - a timed receive completes with nullopt") {
+    asio::io_context          io;
+    auto                      sender = make_sender<int>();
+    std::optional<int>        result = 0;
+    bool                      done   = false;
+    asio::cancellation_signal cancel_signal;
+    asio::co_spawn(io, receive_for_until_cancelled(sender.make_reciever(), result, done),
+                   asio::bind_cancellation_slot(cancel_signal.slot(), asio::detached));
+    io.poll();
+    CHECK_EQ(timer_wheel::for_executor(io.get_executor())->size(), 1);
+
+    cancel_signal.emit(asio::cancellation_type::terminal);
+    io.run(); // Returns at once, the deadline left the wheel with the receive
+    CHECK(done);
+    CHECK_FALSE(result);
+    CHECK_EQ(timer_wheel::for_executor(io.get_executor())->size(), 0);
+}
+
+asio::awaitable<void> sleep_until_cancelled(asio::error_code &ec) {
+    auto exec = co_await asio::this_coro::executor;
+    std::tie(ec) = co_await sleep_for(1h, asio::as_tuple(asio::use_awaitable), exec);
+}
+
+TEST_CASE("Test cancellation - a sleep completes with operation_aborted") {
+    asio::io_context          io;
+    asio::error_code          ec;
+    asio::cancellation_signal cancel_signal;
+    asio::co_spawn(io, sleep_until_cancelled(ec), asio::bind_cancellation_slot(cancel_signal.slot(), asio::detached));
+    io.poll();
+    CHECK_EQ(timer_wheel::for_executor(io.get_executor())->size(), 1);
+
+    cancel_signal.emit(asio::cancellation_type::terminal);
+    io.run(); // Returns at once, the wheel's timer is disarmed with the last sleep
+    CHECK_EQ(ec, asio::error::operation_aborted);
+    CHECK_EQ(timer_wheel::for_executor(io.get_executor())->size(), 0);
+}
+
 asio::awaitable<void> pinger(auto reciever, auto sender) {
     auto exec = co_await asio::this_coro::executor;
     int  x    = 0;
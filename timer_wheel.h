@@ -0,0 +1,551 @@
+#pragma once
+#ifdef ASIO_STANDALONE
+#include <asio/any_io_executor.hpp>
+#include <asio/associated_allocator.hpp>
+#include <asio/associated_executor.hpp>
+#include <asio/async_result.hpp>
+#include <asio/cancellation_type.hpp>
+#include <asio/compose.hpp>
+#include <asio/dispatch.hpp>
+#include <asio/error.hpp>
+#include <asio/execution/context.hpp>
+#include <asio/execution/outstanding_work.hpp>
+#include <asio/execution_context.hpp>
+#include <asio/post.hpp>
+#include <asio/prefer.hpp>
+#include <asio/query.hpp>
+#include <asio/recycling_allocator.hpp>
+#include <asio/steady_timer.hpp>
+#include <asio/version.hpp>
+#if ASIO_VERSION >= 101900
+#include <asio/associated_cancellation_slot.hpp>
+#define COROS_ASIO_CANCELLATION_SLOT 1
+#endif
+#else
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/cancellation_type.hpp>
+#include <boost/asio/compose.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/execution/context.hpp>
+#include <boost/asio/execution/outstanding_work.hpp>
+#include <boost/asio/execution_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/prefer.hpp>
+#include <boost/asio/query.hpp>
+#include <boost/asio/recycling_allocator.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/version.hpp>
+#if BOOST_ASIO_VERSION >= 101900
+#include <boost/asio/associated_cancellation_slot.hpp>
+#define COROS_ASIO_CANCELLATION_SLOT 1
+#endif
+#endif
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Length of one tick in milliseconds. Deadlines are rounded up to a tick and everything due in the same tick expires in one batch, so a
+// coarser tick trades timer precision for fewer wakeups when there are many concurrent timeouts
+#ifndef COROS_TIMER_WHEEL_TICK_MS
+#define COROS_TIMER_WHEEL_TICK_MS 1
+#endif
+
+namespace rebuild::async {
+
+/**
+ * Hierarchical timer wheel (Varghese & Lauck) shared by all timed waits on one executor, see timer_wheel::for_executor.
+ *
+ * Four levels of 64 slots at the default tick of one millisecond cover about 4.6 hours, later deadlines wait in the top level and are placed again
+ * when its slot comes around. Entries are intrusive and live in the waiting operation, so a timed wait has no timer object of its own and
+ * insert/cancel are O(1) list operations. A single asio::steady_timer drives the wheel, armed only while entries are pending and only for
+ * the next occupied slot or level boundary, so idle ticks cost no wakeups.
+ *
+ * There is one wheel per executor, so an io_context run from several threads shares one wheel between them, and the wheel's timer fires on
+ * any of those threads. The wheel locks its own state for that. expire and abandon are called without the lock held, on the wheel's
+ * executor. Whatever they touch must be safe to use from there: a sleep only completes its handler, a timed receive also withdraws the
+ * parked completion from its holder, which is why receive_until must be given the executor (thread or strand) its channel is used from.
+ */
+class timer_wheel : public std::enable_shared_from_this<timer_wheel> {
+  public:
+    using clock      = std::chrono::steady_clock;
+    using time_point = clock::time_point;
+
+    static constexpr auto resolution = std::chrono::milliseconds(COROS_TIMER_WHEEL_TICK_MS);
+    static_assert(resolution.count() > 0, "COROS_TIMER_WHEEL_TICK_MS must be positive");
+
+    // Intrusive hook. expire is called on the wheel's executor once the deadline has passed, the entry is already unlinked by then.
+    // Entries owned by the wheel itself (sleeps) set abandon, it destroys them when the execution context shuts down before they expire
+    struct entry {
+        void (*expire)(entry *){nullptr};
+        void (*abandon)(entry *){nullptr};
+        entry        *prev{nullptr};
+        entry        *next{nullptr};
+        std::uint64_t tick{0};
+        std::uint8_t  level{0};
+
+        bool linked() const { return prev != nullptr; }
+    };
+
+    explicit timer_wheel(asio::any_io_executor exec)
+        : executor_(std::move(exec)), timer_(std::in_place, executor_), current_(tick_of(clock::now())) {
+        for (auto &level : slots_) {
+            for (auto &slot : level) {
+                slot.prev = slot.next = &slot;
+            }
+        }
+    }
+
+    timer_wheel(const timer_wheel &)            = delete;
+    timer_wheel &operator=(const timer_wheel &) = delete;
+
+    // The wheel for exec, one per executor of an execution context, created on first use
+    static std::shared_ptr<timer_wheel> for_executor(const asio::any_io_executor &exec);
+
+    // The executor the wheel was created for, its timer and so every expire runs there. Not counted as outstanding work
+    const asio::any_io_executor &get_executor() const { return executor_; }
+
+    void insert(entry &e, time_point deadline) {
+        std::lock_guard lock(mutex_);
+        assert(!e.linked() && "entry is already waiting");
+        if (size_ == 0) {
+            // Nothing pending, so nothing can be skipped by catching up with the clock
+            current_ = std::max(current_, tick_of(clock::now()));
+        }
+        e.tick = std::max(ceil_tick(deadline), current_ + 1);
+        this->place(e);
+        ++size_;
+        this->arm();
+    }
+
+    // False if the entry has expired (or is about to, its expire call may be running on another thread) or was never inserted
+    bool cancel(entry &e) {
+        std::lock_guard lock(mutex_);
+        if (!e.linked()) {
+            return false;
+        }
+        this->unlink(e);
+        --size_;
+        return true;
+    }
+
+    // An armed timer is outstanding work and keeps the io_context running. Waits call this once they are done with the wheel, after their
+    // completion handler returned, so a wait that immediately follows (the common receive loop) keeps the timer armed
+    void disarm_if_idle() {
+        std::lock_guard lock(mutex_);
+        if (size_ == 0 && armed_ && timer_) {
+            armed_ = false;
+            ++generation_;
+            timer_->cancel();
+        }
+    }
+
+    std::size_t size() const {
+        std::lock_guard lock(mutex_);
+        return size_;
+    }
+
+    // The execution context is going away, pending entries never expire. Like asio's own pending operations, the ones the wheel owns are
+    // destroyed without being completed
+    void shutdown() {
+        std::unique_lock lock(mutex_);
+        shut_down_ = true;
+        timer_.reset();
+        entry dropped;
+        dropped.prev = dropped.next = &dropped;
+        for (auto &level : slots_) {
+            for (auto &slot : level) {
+                entry taken;
+                splice(slot, taken);
+                while (!empty(taken)) {
+                    auto &e = *taken.next;
+                    this->unlink(e);
+                    e.level = detached;
+                    link(dropped, e);
+                }
+            }
+        }
+        this->run_detached(lock, dropped, &entry::abandon);
+    }
+    bool is_shut_down() const { return shut_down_.load(std::memory_order_acquire); }
+
+  private:
+    static constexpr std::size_t   bits     = 6;
+    static constexpr std::size_t   levels   = 4;
+    static constexpr std::size_t   slots    = std::size_t{1} << bits;
+    static constexpr std::uint64_t mask     = slots - 1;
+    static constexpr std::uint64_t span     = std::uint64_t{1} << (bits * levels);
+    static constexpr std::uint8_t  detached = 0xFF; // Taken out of the wheel, about to expire
+
+    static std::uint64_t tick_of(time_point t) {
+        return static_cast<std::uint64_t>(std::chrono::floor<std::chrono::milliseconds>(t.time_since_epoch()) / resolution);
+    }
+    static std::uint64_t ceil_tick(time_point t) {
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(t.time_since_epoch());
+        return static_cast<std::uint64_t>((ms + resolution - std::chrono::milliseconds(1)) / resolution);
+    }
+    static time_point time_of(std::uint64_t tick) {
+        return time_point(std::chrono::duration_cast<clock::duration>(resolution * static_cast<std::int64_t>(tick)));
+    }
+
+    static bool empty(const entry &slot) { return slot.next == &slot; }
+
+    static void link(entry &slot, entry &e) {
+        e.prev          = slot.prev;
+        e.next          = &slot;
+        slot.prev->next = &e;
+        slot.prev       = &e;
+    }
+
+    void unlink(entry &e) {
+        e.prev->next = e.next;
+        e.next->prev = e.prev;
+        e.prev = e.next = nullptr;
+        if (e.level != detached) {
+            --counts_[e.level];
+        }
+    }
+
+    // Moves every entry of slot to the list headed by to
+    static void splice(entry &slot, entry &to) {
+        to.prev = to.next = &to;
+        if (empty(slot)) {
+            return;
+        }
+        to.next         = slot.next;
+        to.prev         = slot.prev;
+        to.next->prev   = &to;
+        to.prev->next   = &to;
+        slot.prev = slot.next = &slot;
+    }
+
+    void place(entry &e) {
+        auto          delta = e.tick - current_;
+        std::uint8_t  level = 0;
+        std::uint64_t tick  = e.tick;
+        while (level + 1U < levels && delta >= (std::uint64_t{1} << (bits * (level + 1U)))) {
+            ++level;
+        }
+        if (delta >= span) {
+            tick = current_ + span - 1;
+        }
+        e.level = level;
+        link(slots_[level][(tick >> (bits * level)) & mask], e);
+        ++counts_[level];
+    }
+
+    // The first tick that expires or cascades something, the lowest occupied level always has the earliest boundary
+    std::uint64_t next_event() const {
+        auto next = std::numeric_limits<std::uint64_t>::max();
+        if (counts_[0] > 0) {
+            for (auto tick = current_ + 1; tick <= current_ + slots; ++tick) {
+                if (!empty(slots_[0][tick & mask])) {
+                    next = tick;
+                    break;
+                }
+            }
+        }
+        for (std::size_t level = 1; level < levels; ++level) {
+            if (counts_[level] > 0) {
+                auto shift = bits * level;
+                next       = std::min(next, ((current_ >> shift) + 1) << shift);
+                break;
+            }
+        }
+        return next;
+    }
+
+    // Runs the due ticks up to now, jumping over the ones where nothing happens
+    void advance(std::unique_lock<std::mutex> &lock, std::uint64_t now) {
+        while (size_ > 0) {
+            auto next = this->next_event();
+            if (next > now) {
+                break;
+            }
+            current_ = next - 1;
+            this->step(lock);
+        }
+        current_ = std::max(current_, now);
+    }
+
+    void step(std::unique_lock<std::mutex> &lock) {
+        ++current_;
+        // Cascade from the highest level with a boundary here down, entries moving down may land in a lower slot cascaded right after
+        std::size_t top = 0;
+        while (top + 1 < levels && (current_ & ((std::uint64_t{1} << (bits * (top + 1))) - 1)) == 0) {
+            ++top;
+        }
+        for (auto level = top; level > 0; --level) {
+            entry moving;
+            auto &slot = slots_[level][(current_ >> (bits * level)) & mask];
+            splice(slot, moving);
+            while (!empty(moving)) {
+                auto &e = *moving.next;
+                this->unlink(e);
+                this->place(e);
+            }
+        }
+
+        // Everything in the slot expires in one batch. Callbacks may insert or cancel entries, including the ones still due here
+        entry due;
+        auto &slot = slots_[0][current_ & mask];
+        splice(slot, due);
+        for (auto *e = due.next; e != &due; e = e->next) {
+            e->level = detached;
+            --counts_[0];
+        }
+        this->run_detached(lock, due, &entry::expire);
+    }
+
+    // Takes the entries of list one by one and calls them without the lock, they may insert or cancel entries, also the ones still in
+    // list, which another thread may do as well
+    void run_detached(std::unique_lock<std::mutex> &lock, entry &list, void (*entry::*callback)(entry *)) {
+        while (!empty(list)) {
+            auto &e = *list.next;
+            this->unlink(e);
+            --size_;
+            if (auto *f = e.*callback) {
+                lock.unlock();
+                f(&e);
+                lock.lock();
+            }
+        }
+    }
+
+    void arm() {
+        if (size_ == 0 || !timer_) {
+            return;
+        }
+        auto next = this->next_event();
+        if (armed_ && armed_tick_ <= next) {
+            return;
+        }
+        armed_      = true;
+        armed_tick_ = next;
+        timer_->expires_at(time_of(next));
+        timer_->async_wait([self = this->shared_from_this(), generation = ++generation_](const asio::error_code &ec) {
+            std::unique_lock lock(self->mutex_);
+            // Superseded by an earlier deadline, or shut down
+            if (generation != self->generation_ || ec == asio::error::operation_aborted) {
+                return;
+            }
+            self->armed_ = false;
+            self->advance(lock, tick_of(clock::now()));
+            self->arm();
+        });
+    }
+
+    asio::any_io_executor                        executor_;
+    mutable std::mutex                           mutex_;
+    std::array<std::array<entry, slots>, levels> slots_;
+    std::array<std::size_t, levels>              counts_{};
+    std::optional<asio::steady_timer>            timer_;
+    std::uint64_t                                current_;
+    std::size_t                                  size_{0};
+    std::uint64_t                                armed_tick_{0};
+    std::uint64_t                                generation_{0};
+    bool                                         armed_{false};
+    std::atomic<bool>                            shut_down_{false};
+};
+
+// Owns the wheels of one execution context, looked up with asio::use_service
+class timer_wheel_service : public asio::execution_context::service {
+  public:
+    static inline asio::execution_context::id id;
+
+    explicit timer_wheel_service(asio::execution_context &context) : asio::execution_context::service(context) {}
+
+    std::shared_ptr<timer_wheel> wheel_for(const asio::any_io_executor &exec) {
+        std::lock_guard lock(mutex_);
+        for (auto &[executor, wheel] : wheels_) {
+            if (executor == exec) {
+                return wheel;
+            }
+        }
+        return wheels_.emplace_back(exec, std::make_shared<timer_wheel>(exec)).second;
+    }
+
+  private:
+    void shutdown() override {
+        std::lock_guard lock(mutex_);
+        for (auto &[executor, wheel] : wheels_) {
+            wheel->shutdown();
+        }
+        wheels_.clear();
+    }
+
+    std::mutex                                                              mutex_;
+    std::vector<std::pair<asio::any_io_executor, std::shared_ptr<timer_wheel>>> wheels_;
+};
+
+inline std::shared_ptr<timer_wheel> timer_wheel::for_executor(const asio::any_io_executor &exec) {
+    // Kept executors must not count as outstanding work, or the io_context would never run out of it
+    asio::any_io_executor key = asio::prefer(exec, asio::execution::outstanding_work.untracked);
+
+    // Timed waits on a thread mostly use the executor of the previous one, that skips the service registry and its locks. A wheel that
+    // was shut down belongs to a destroyed context (maybe one at the same address) and is looked up again
+    thread_local struct {
+        asio::any_io_executor        executor;
+        std::shared_ptr<timer_wheel> wheel;
+    } last;
+    if (last.wheel && !last.wheel->is_shut_down() && last.executor == key) {
+        return last.wheel;
+    }
+
+    auto &context = asio::query(key, asio::execution::context);
+    last.wheel    = asio::use_service<timer_wheel_service>(context).wheel_for(key);
+    last.executor = std::move(key);
+    return last.wheel;
+}
+
+namespace detail {
+// Composed operations expose the cancellation state of their handler, hand written Selves (and asio before 1.19) have none
+template <typename Self>
+concept has_cancellation_state = requires(Self &self) { self.get_cancellation_state().slot(); };
+
+// Completing, the slot handler must not outlive the operation
+template <typename Self> void clear_cancellation(Self &self) {
+    if constexpr (has_cancellation_state<Self>) {
+        self.get_cancellation_state().slot().clear();
+    }
+}
+
+// A pending sleep, owned by the wheel until it expires, is cancelled or is abandoned at shutdown. It holds the completion handler itself
+// and is allocated with the handler's allocator, asio's recycling allocator unless the handler brings its own. Started with
+// async_initiate rather than async_compose: on older asio a composed operation reports std::allocator, and with use_awaitable its
+// initiation (the handler wrapper and its work executors) makes a coroutine frame too large for asio's recycled frame block. Each cost
+// an allocation per sleep
+template <typename Handler> class sleep_operation : public timer_wheel::entry {
+    using allocator_type = typename std::allocator_traits<decltype(asio::get_associated_allocator(
+        std::declval<const Handler &>(), asio::recycling_allocator<void>()))>::template rebind_alloc<sleep_operation>;
+    using traits = std::allocator_traits<allocator_type>;
+    // The handler's executor, counted as outstanding work until the handler runs, like asio's own operations do
+    using work_type = std::decay_t<decltype(asio::prefer(
+        asio::get_associated_executor(std::declval<const Handler &>(), std::declval<const asio::any_io_executor &>()),
+        asio::execution::outstanding_work.tracked))>;
+
+  public:
+    static void start(Handler &&handler, std::shared_ptr<timer_wheel> wheel, timer_wheel::time_point deadline) {
+        allocator_type allocator(asio::get_associated_allocator(handler, asio::recycling_allocator<void>()));
+        auto          *op = traits::allocate(allocator, 1);
+        ::new (static_cast<void *>(op)) sleep_operation(std::move(handler), std::move(wheel), allocator);
+
+#ifdef COROS_ASIO_CANCELLATION_SLOT
+        auto slot = asio::get_associated_cancellation_slot(op->handler_);
+        if (slot.is_connected()) {
+            slot.assign([op](asio::cancellation_type type) {
+                if (type != asio::cancellation_type::none) {
+                    op->abort();
+                }
+            });
+        }
+#endif
+        auto &wheel_ref = *op->wheel_;
+        wheel_ref.insert(*op, deadline);
+    }
+
+  private:
+    sleep_operation(Handler &&handler, std::shared_ptr<timer_wheel> wheel, const allocator_type &allocator)
+        : timer_wheel::entry{&sleep_operation::expired, &sleep_operation::abandoned},
+          work_(asio::prefer(asio::get_associated_executor(handler, wheel->get_executor()), asio::execution::outstanding_work.tracked)),
+          handler_(std::move(handler)), wheel_(std::move(wheel)), allocator_(allocator) {}
+
+    struct released {
+        work_type                    work;
+        Handler                      handler;
+        std::shared_ptr<timer_wheel> wheel;
+
+        // Completing, the slot handler must not outlive the operation
+        void clear_cancellation() {
+#ifdef COROS_ASIO_CANCELLATION_SLOT
+            asio::get_associated_cancellation_slot(handler).clear();
+#endif
+        }
+    };
+
+    // Frees the operation first, so the handler can start the next sleep from the same storage
+    released release() {
+        released taken{std::move(work_), std::move(handler_), std::move(wheel_)};
+        auto     allocator = allocator_;
+        this->~sleep_operation();
+        traits::deallocate(allocator, this, 1);
+        return taken;
+    }
+
+    // Runs on the wheel's executor, the handler runs right here if that is also its own executor
+    static void expired(timer_wheel::entry *e) {
+        auto taken = static_cast<sleep_operation *>(e)->release();
+        taken.clear_cancellation();
+        auto wheel = std::move(taken.wheel);
+        auto exec  = taken.work;
+        asio::dispatch(exec, [taken = std::move(taken)]() mutable { std::move(taken.handler)(asio::error_code()); });
+        wheel->disarm_if_idle();
+    }
+
+    static void abandoned(timer_wheel::entry *e) { static_cast<sleep_operation *>(e)->release(); }
+
+    // Runs inside the cancellation slot's handler, which must not be cleared from there, so the completion is posted
+    void abort() {
+        if (!wheel_->cancel(*this)) {
+            return; // Expiring on another thread, which completes it
+        }
+        auto taken = this->release();
+        auto exec  = taken.work;
+        asio::post(exec, [taken = std::move(taken)]() mutable {
+            taken.clear_cancellation();
+            std::move(taken.handler)(asio::error_code(asio::error::operation_aborted));
+            taken.wheel->disarm_if_idle();
+        });
+    }
+
+    work_type                    work_;
+    Handler                      handler_;
+    std::shared_ptr<timer_wheel> wheel_;
+    allocator_type               allocator_;
+};
+
+struct initiate_sleep {
+    template <typename Handler> void operator()(Handler &&handler, timer_wheel::time_point deadline) {
+        sleep_operation<std::decay_t<Handler>>::start(std::forward<Handler>(handler), std::move(wheel), deadline);
+    }
+
+    std::shared_ptr<timer_wheel> wheel;
+};
+} // namespace detail
+
+/**
+ * Waits on the executor's timer wheel instead of a timer of its own, completes with void(asio::error_code), e.g.
+ *
+ *   co_await sleep_for(std::chrono::milliseconds(50), asio::use_awaitable, exec);     // from an asio::awaitable
+ *   auto ec = co_await sleep_for(std::chrono::milliseconds(50), use_shared_task, exec); // from a SharedTask
+ *
+ * Deadlines are rounded up to the wheel's tick (COROS_TIMER_WHEEL_TICK_MS), sleeps ending in the same tick complete in one batch.
+ * Safe with an io_context run from several threads, the sleeps of all of them share the context's wheel, see timer_wheel.
+ * A terminal, partial or total cancellation completes with asio::error::operation_aborted.
+ */
+template <typename CompletionToken, typename Executor>
+auto sleep_until(timer_wheel::time_point deadline, CompletionToken &&token, const Executor &exec) {
+    return asio::async_initiate<CompletionToken, void(asio::error_code)>(detail::initiate_sleep{timer_wheel::for_executor(exec)}, token,
+                                                                          deadline);
+}
+
+template <typename Rep, typename Period, typename CompletionToken, typename Executor>
+auto sleep_for(std::chrono::duration<Rep, Period> duration, CompletionToken &&token, const Executor &exec) {
+    return sleep_until(timer_wheel::clock::now() + std::chrono::ceil<timer_wheel::clock::duration>(duration),
+                       std::forward<CompletionToken>(token), exec);
+}
+
+} // namespace rebuild::async
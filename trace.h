@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Compile time selected tracing for the coroutine machinery (SharedCoroutine, TaskImpl).
+ *
+ *   default              COROS_TRACE(...) compiles to nothing
+ *   COROS_TRACE_RING     events go to rebuild::trace_ring, a fixed size lock-free ring buffer, read it with snapshot()
+ *   COROS_TRACE_SPDLOG   events are logged with spdlog::info, visible at spdlog's default level
+ *
+ * Events are string literals plus the address of the object they concern, nothing is formatted on the hot path.
+ */
+#if defined(COROS_TRACE_SPDLOG)
+#include <spdlog/spdlog.h>
+#define COROS_TRACE(what, object) spdlog::info("{} ({})", what, static_cast<const void *>(object))
+#elif defined(COROS_TRACE_RING)
+#define COROS_TRACE(what, object) ::rebuild::trace_ring::instance().record(what, object)
+#else
+#define COROS_TRACE(what, object) static_cast<void>(0)
+#endif
+
+#ifndef COROS_TRACE_RING_SIZE
+#define COROS_TRACE_RING_SIZE 4096
+#endif
+
+namespace rebuild {
+
+struct trace_event {
+    const char   *what;
+    const void   *object;
+    std::uint64_t timestamp_ns;
+};
+
+/**
+ * Multi-producer ring of the most recent trace events, writers never block or wait for each other.
+ *
+ * Each record takes a ticket with one fetch_add and overwrites the oldest slot. A slot carries the ticket it was written for (seqlock
+ * style), so snapshot() skips slots that are being written or were overwritten while it copied them. Best effort by design: when
+ * writers lap the whole ring while another is still writing a slot, that slot's event may be dropped.
+ */
+class trace_ring {
+  public:
+    static constexpr std::size_t capacity = COROS_TRACE_RING_SIZE;
+    static_assert((capacity & (capacity - 1)) == 0, "COROS_TRACE_RING_SIZE must be a power of two");
+
+    static trace_ring &instance() {
+        static trace_ring ring;
+        return ring;
+    }
+
+    void record(const char *what, const void *object) noexcept {
+        auto  ticket = next_.fetch_add(1, std::memory_order_relaxed);
+        auto &slot   = slots_[ticket & (capacity - 1)];
+        auto  now    = std::chrono::steady_clock::now().time_since_epoch();
+
+        slot.sequence.store(0, std::memory_order_relaxed); // 0 = being written
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.what.store(what, std::memory_order_relaxed);
+        slot.object.store(object, std::memory_order_relaxed);
+        slot.timestamp_ns.store(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()),
+                                std::memory_order_relaxed);
+        slot.sequence.store(ticket + 1, std::memory_order_release);
+    }
+
+    // The retained events, oldest first
+    std::vector<trace_event> snapshot() const {
+        auto end   = next_.load(std::memory_order_acquire);
+        auto begin = end > capacity ? end - capacity : 0;
+
+        std::vector<trace_event> events;
+        events.reserve(end - begin);
+        for (auto ticket = begin; ticket < end; ++ticket) {
+            auto &slot = slots_[ticket & (capacity - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != ticket + 1) {
+                continue;
+            }
+            trace_event event{slot.what.load(std::memory_order_relaxed), slot.object.load(std::memory_order_relaxed),
+                              slot.timestamp_ns.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == ticket + 1) {
+                events.push_back(event);
+            }
+        }
+        return events;
+    }
+
+    void clear() noexcept {
+        for (auto &slot : slots_) {
+            slot.sequence.store(0, std::memory_order_relaxed);
+        }
+        next_.store(0, std::memory_order_release);
+    }
+
+  private:
+    struct slot {
+        std::atomic<std::uint64_t> sequence{0};
+        std::atomic<const char *>  what{nullptr};
+        std::atomic<const void *>  object{nullptr};
+        std::atomic<std::uint64_t> timestamp_ns{0};
+    };
+
+    std::atomic<std::uint64_t> next_{0};
+    std::array<slot, capacity> slots_;
+};
+
+} // namespace rebuild
@@ -2,6 +2,8 @@
 
 #include <cassert>
 #include <coroutine>
+#include <type_traits>
+#include <utility>
 
 template <typename T, template <typename...> typename Promise>
 class unique_coroutine {
@@ -48,6 +50,46 @@ public:
     return handle_.done();
   }
 
+  std::coroutine_handle<promise_type> handle() const noexcept { return handle_; }
+
+  // Result of a finished coroutine, rethrows an exception that escaped it
+  decltype(auto) result() {
+    assert(is_done());
+    return handle_.promise().result();
+  }
+
+  // Awaiting starts the (lazy) coroutine and continues the awaiting one when
+  // it finishes, both by symmetric transfer, so neither direction nests
+  // resume() calls on the stack
+  auto operator co_await() noexcept
+    requires requires(promise_type &p) {
+      p.set_continuation(std::coroutine_handle<>{});
+    }
+  {
+    struct awaiter {
+      std::coroutine_handle<promise_type> handle_;
+
+      bool await_ready() const noexcept { return handle_.done(); }
+
+      std::coroutine_handle<>
+      await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().set_continuation(awaiting);
+        return handle_;
+      }
+
+      // Rethrows an exception that escaped the awaited coroutine
+      T await_resume() {
+        if constexpr (!std::is_void_v<T>) {
+          return std::move(handle_.promise().result());
+        } else {
+          handle_.promise().result();
+        }
+      }
+    };
+    assert(handle_ != nullptr);
+    return awaiter{handle_};
+  }
+
 private:
   std::coroutine_handle<promise_type> handle_;
 };
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <async/shared_coroutine.h>
+
+#include <asio/async_result.hpp>
+#include <concepts>
+#include <coroutine>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace rebuild::async {
+
+/**
+ * Completion token that makes an asio initiating function directly awaitable from a SharedTask, e.g.
+ *   auto ec = co_await timer.async_wait(use_shared_task);
+ *   auto [ec, n] = co_await socket.async_read_some(buffer, use_shared_task);
+ *
+ * Unlike AsioAwaitable(io, op(asio::use_awaitable)) there is no asio::awaitable frame, no co_spawn and no extra post: the operation is
+ * initiated from await_suspend, its handler stores the completion arguments in the awaiter (inside the task's frame) and resumes the
+ * task through TaskImpl::resume(), on whichever thread the operation completes on.
+ *
+ * The result is the completion arguments: nothing for void(), the value for a single argument, a std::tuple otherwise. A failed
+ * operation is one of those values (an error_code, or the exception_ptr of a signature that has one) and is never thrown, the caller
+ * must check it. An exception thrown by the initiating function comes out of the co_await. One that escapes the task finishes it and is
+ * rethrown from the resume() that ran it, for a completed operation that is the handler, so it leaves io_context::run() like an
+ * exception from any other handler.
+ */
+struct use_shared_task_t {
+    constexpr use_shared_task_t() = default;
+};
+
+inline constexpr use_shared_task_t use_shared_task;
+
+namespace detail {
+
+template <typename... Args> struct shared_task_result {
+    using type = std::tuple<std::decay_t<Args>...>;
+};
+template <typename Arg> struct shared_task_result<Arg> {
+    using type = std::decay_t<Arg>;
+};
+template <> struct shared_task_result<> {
+    using type = void;
+};
+
+} // namespace detail
+
+// Awaiter returned by an initiating function called with use_shared_task, await it exactly once
+template <typename Initiation, typename Signature, typename... InitArgs> class shared_task_operation;
+
+template <typename Initiation, typename... Args, typename... InitArgs>
+class [[nodiscard]] shared_task_operation<Initiation, void(Args...), InitArgs...> {
+  public:
+    using result_type = typename detail::shared_task_result<Args...>::type;
+
+    template <typename I, typename... A>
+    explicit shared_task_operation(I &&initiation, A &&...args)
+        : initiation_(std::forward<I>(initiation)), args_(std::forward<A>(args)...) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    template <typename Promise>
+        requires std::convertible_to<decltype(std::declval<Promise &>().shared_from_this()), TaskImpl::Ptr>
+    void await_suspend(std::coroutine_handle<Promise> handle) {
+        // The handler owns the task until the operation completes (or is destroyed without completing)
+        std::apply(
+            [this, &handle](auto &&...args) {
+                std::move(initiation_)(handler{this, handle.promise().shared_from_this()}, std::forward<decltype(args)>(args)...);
+            },
+            std::move(args_));
+    }
+
+    result_type await_resume() {
+        if constexpr (sizeof...(Args) == 1) {
+            return std::get<0>(std::move(*result_));
+        } else if constexpr (sizeof...(Args) > 1) {
+            return std::move(*result_);
+        }
+    }
+
+  private:
+    struct handler {
+        void operator()(Args... args) {
+            self->result_.emplace(std::forward<Args>(args)...);
+            // Resuming may destroy *self, and this handler with the frame's last reference, so the reference moves to the stack first
+            auto resumed = std::move(task);
+            resumed->resume();
+        }
+
+        shared_task_operation *self;
+        TaskImpl::Ptr          task;
+    };
+
+    Initiation                                       initiation_;
+    std::tuple<InitArgs...>                          args_;
+    std::optional<std::tuple<std::decay_t<Args>...>> result_;
+};
+
+} // namespace rebuild::async
+
+template <typename R, typename... Args> struct asio::async_result<rebuild::async::use_shared_task_t, R(Args...)> {
+    // Nothing is started here, the operation is initiated when the returned awaiter is co_awaited
+    template <typename Initiation, typename... InitArgs>
+    static auto initiate(Initiation &&initiation, rebuild::async::use_shared_task_t, InitArgs &&...args) {
+        return rebuild::async::shared_task_operation<std::decay_t<Initiation>, void(Args...), std::decay_t<InitArgs>...>(
+            std::forward<Initiation>(initiation), std::forward<InitArgs>(args)...);
+    }
+};
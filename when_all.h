@@ -0,0 +1,301 @@
+#pragma once
+
+#include <async/shared_coroutine.h>
+#include <async/task.h>
+
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+/**
+ * Structured fan-out over coroutines, one atomic countdown per combinator and no allocation per child:
+ *
+ *   auto [a, b] = co_await when_all(fetch(1), fetch(2));      // task<T>, results as a tuple (void -> std::monostate)
+ *   co_await when_all(rpc(x), rpc(y));                         // SharedTask, started here
+ *   auto first = co_await when_any(rpc(x), rpc(y));            // SharedTask, index of the first to finish
+ *
+ * The per child bookkeeping lives in the awaiter, i.e. in the awaiting coroutine's frame. Exceptions that escaped a child are rethrown
+ * from the co_await, the first child (in argument order) wins. For select over channels see receive_any in sender_reciever.h.
+ */
+namespace rebuild {
+
+namespace detail {
+
+// Resumes the coroutine awaiting a combinator, through TaskImpl when it is a SharedTask so its state machine is respected
+class parent_resumer {
+  public:
+    template <typename Promise> void set(std::coroutine_handle<Promise> handle) {
+        if constexpr (requires(Promise &p) {
+                          { p.shared_from_this() } -> std::convertible_to<TaskImpl::Ptr>;
+                      }) {
+            task_ = handle.promise().shared_from_this();
+        } else {
+            handle_ = handle;
+        }
+    }
+
+    void resume() {
+        if (task_) {
+            // Resuming may destroy the awaiter holding this, keep the reference on the stack
+            auto task = std::move(task_);
+            task->resume();
+        } else {
+            handle_.resume();
+        }
+    }
+
+    // Not resumed after all (await_suspend returned false), drops the reference to the awaiting task
+    void reset() noexcept { task_.reset(); }
+
+  private:
+    TaskImpl::Ptr           task_;
+    std::coroutine_handle<> handle_;
+};
+
+template <typename T> using when_all_value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+} // namespace detail
+
+// Starts every task from await_suspend, the child that finishes last continues the awaiting coroutine by symmetric transfer
+template <typename... Ts> class [[nodiscard]] when_all_tasks {
+  public:
+    explicit when_all_tasks(task<Ts> &&...tasks) : tasks_(std::move(tasks)...) {}
+
+    bool await_ready() const noexcept { return sizeof...(Ts) == 0; }
+
+    bool await_suspend(std::coroutine_handle<> awaiting) {
+        // One count per child plus one for this call, so no child can continue the awaiting coroutine before it has suspended
+        remaining_.store(sizeof...(Ts) + 1, std::memory_order_relaxed);
+        std::apply(
+            [this, awaiting](auto &...tasks) {
+                (this->start(tasks, awaiting), ...);
+            },
+            tasks_);
+        return remaining_.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+
+    std::tuple<detail::when_all_value<Ts>...> await_resume() {
+        return std::apply([](auto &...tasks) { return std::tuple<detail::when_all_value<Ts>...>{take(tasks)...}; }, tasks_);
+    }
+
+  private:
+    template <typename T> void start(task<T> &t, std::coroutine_handle<> awaiting) {
+        auto handle = t.handle();
+        handle.promise().set_continuation(awaiting, &remaining_);
+        handle.resume();
+    }
+
+    template <typename T> static detail::when_all_value<T> take(task<T> &t) {
+        if constexpr (std::is_void_v<T>) {
+            t.result();
+            return {};
+        } else {
+            return std::move(t.result());
+        }
+    }
+
+    std::tuple<task<Ts>...>  tasks_;
+    std::atomic<std::size_t> remaining_{0};
+};
+
+// Waits for every SharedTask, optionally starting them
+template <std::size_t N> class [[nodiscard]] when_all_shared {
+  public:
+    when_all_shared(std::array<TaskImpl::Ptr, N> tasks, bool start) : tasks_(std::move(tasks)), start_(start) {}
+
+    bool await_ready() const noexcept { return N == 0; }
+
+    template <typename Promise> bool await_suspend(std::coroutine_handle<Promise> awaiting) {
+        parent_.set(awaiting);
+        remaining_.store(N + 1, std::memory_order_relaxed);
+        for (std::size_t i = 0; i < N; ++i) {
+            branches_[i].self = this;
+            if (!tasks_[i]->notify_when_done(&branches_[i])) {
+                remaining_.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+        if (start_) {
+            start_all(tasks_);
+        }
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            parent_.reset();
+            return false;
+        }
+        return true;
+    }
+
+    void await_resume() const {
+        for (auto &task : tasks_) {
+            if (auto exception = task->exception()) {
+                std::rethrow_exception(exception);
+            }
+        }
+    }
+
+  private:
+    struct branch : TaskImpl::done_waiter {
+        branch() : TaskImpl::done_waiter{&branch::notify} {}
+
+        static void notify(TaskImpl::done_waiter *waiter) {
+            auto *self = static_cast<branch *>(waiter)->self;
+            if (self->remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                self->parent_.resume();
+            }
+        }
+
+        when_all_shared *self{nullptr};
+    };
+
+    template <typename Tasks> static void start_all(Tasks &tasks) {
+        for (auto &task : tasks) {
+            try {
+                task->try_resume();
+            } catch (...) {
+                // Kept on the task and rethrown by await_resume
+            }
+        }
+    }
+
+    std::array<TaskImpl::Ptr, N> tasks_;
+    std::array<branch, N>        branches_;
+    detail::parent_resumer       parent_;
+    std::atomic<std::size_t>     remaining_{0};
+    bool                         start_;
+
+    template <std::size_t> friend class when_any_shared;
+};
+
+/**
+ * Resumes the awaiting coroutine once the first SharedTask finishes, returns its index. The others keep running (their owners keep
+ * them alive), only the notification is withdrawn.
+ *
+ * Every branch is accounted for exactly once, either by its notification or by a successful withdrawal, and the awaiting coroutine is
+ * resumed only after all are accounted for, so no late notification can reach the awaiter after it is gone. Withdrawing happens once
+ * both the winner is known and every branch is registered, by whichever of the two comes last.
+ */
+template <std::size_t N> class [[nodiscard]] when_any_shared {
+  public:
+    when_any_shared(std::array<TaskImpl::Ptr, N> tasks, bool start) : tasks_(std::move(tasks)), start_(start) {}
+
+    bool await_ready() const noexcept { return N == 0; }
+
+    template <typename Promise> bool await_suspend(std::coroutine_handle<Promise> awaiting) {
+        parent_.set(awaiting);
+        // One count per branch, one for withdrawing the losers and one for this call
+        remaining_.store(N + 2, std::memory_order_relaxed);
+        for (std::size_t i = 0; i < N; ++i) {
+            branches_[i].self  = this;
+            branches_[i].index = i;
+            if (!tasks_[i]->notify_when_done(&branches_[i])) {
+                this->finished(i);
+            }
+        }
+        this->withdraw_gate();
+        if (start_) {
+            when_all_shared<N>::start_all(tasks_);
+        }
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            parent_.reset();
+            return false;
+        }
+        return true;
+    }
+
+    std::size_t await_resume() const {
+        auto index = winner_.load(std::memory_order_acquire);
+        if (auto exception = tasks_[index]->exception()) {
+            std::rethrow_exception(exception);
+        }
+        return index;
+    }
+
+  private:
+    static constexpr std::size_t no_winner = std::numeric_limits<std::size_t>::max();
+
+    struct branch : TaskImpl::done_waiter {
+        branch() : TaskImpl::done_waiter{&branch::notify} {}
+
+        static void notify(TaskImpl::done_waiter *waiter) {
+            auto *b = static_cast<branch *>(waiter);
+            b->self->finished(b->index);
+        }
+
+        when_any_shared *self{nullptr};
+        std::size_t      index{0};
+    };
+
+    void finished(std::size_t index) {
+        auto expected = no_winner;
+        if (winner_.compare_exchange_strong(expected, index, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            this->withdraw_gate();
+        }
+        this->release();
+    }
+
+    // Passed twice, once when the winner is known and once when every branch is registered
+    void withdraw_gate() {
+        if (gate_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        auto winner = winner_.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < N; ++i) {
+            if (i != winner && tasks_[i]->cancel_notify(&branches_[i])) {
+                this->release();
+            }
+        }
+        this->release();
+    }
+
+    void release() {
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            parent_.resume();
+        }
+    }
+
+    std::array<TaskImpl::Ptr, N> tasks_;
+    std::array<branch, N>        branches_;
+    detail::parent_resumer       parent_;
+    std::atomic<std::size_t>     remaining_{0};
+    std::atomic<std::size_t>     winner_{no_winner};
+    std::atomic<int>             gate_{2};
+    bool                         start_;
+};
+
+// Takes ownership of lazy tasks and runs them all
+template <typename... Ts> when_all_tasks<Ts...> when_all(task<Ts> &&...tasks) { return when_all_tasks<Ts...>(std::move(tasks)...); }
+
+// Freshly created SharedTasks are started by the combinator
+template <typename... Tasks>
+    requires(sizeof...(Tasks) > 0 && (std::same_as<std::remove_cvref_t<Tasks>, SharedTask> && ...))
+when_all_shared<sizeof...(Tasks)> when_all(Tasks &&...tasks) {
+    return {{TaskImpl::Ptr(tasks)...}, true};
+}
+
+// Existing handles are only waited for, whoever owns them resumes them
+template <typename... Tasks>
+    requires(sizeof...(Tasks) > 0 && (std::same_as<std::remove_cvref_t<Tasks>, TaskImpl::Ptr> && ...))
+when_all_shared<sizeof...(Tasks)> when_all(const Tasks &...tasks) {
+    return {{tasks...}, false};
+}
+
+template <typename... Tasks>
+    requires(sizeof...(Tasks) > 0 && (std::same_as<std::remove_cvref_t<Tasks>, SharedTask> && ...))
+when_any_shared<sizeof...(Tasks)> when_any(Tasks &&...tasks) {
+    return {{TaskImpl::Ptr(tasks)...}, true};
+}
+
+template <typename... Tasks>
+    requires(sizeof...(Tasks) > 0 && (std::same_as<std::remove_cvref_t<Tasks>, TaskImpl::Ptr> && ...))
+when_any_shared<sizeof...(Tasks)> when_any(const Tasks &...tasks) {
+    return {{tasks...}, false};
+}
+
+} // namespace rebuild
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <async/shared_coroutine.h>
+#include <infrastructure/chase_lev_deque.h>
+#include <infrastructure/mpsc_queue.h>
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace rebuild {
+
+// Intrusive unit of work for work_stealing_pool, execute is called exactly once on a worker thread
+struct pool_work : mpsc_node {
+    explicit pool_work(void (*execute)(pool_work *)) : execute_(execute) {}
+
+    void (*execute_)(pool_work *);
+};
+
+/**
+ * Fixed set of worker threads, one Chase-Lev deque each, idle workers steal from the others.
+ *
+ * Work scheduled from a worker goes to that worker's own deque (no shared cache line is touched), work scheduled from any other thread
+ * goes to a shared injection queue. A worker takes from its own deque first, then the injection queue, then steals from a random victim.
+ * Workers with nothing to do sleep on an atomic wait and are woken only when there are sleepers, so a busy pool never makes a syscall.
+ *
+ * The destructor runs all work that is still queued (including work scheduled by that work) and joins the workers.
+ */
+class work_stealing_pool {
+  public:
+    explicit work_stealing_pool(std::size_t threads = std::max(std::thread::hardware_concurrency(), 1U)) : workers_(threads) {
+        threads_.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) {
+            threads_.emplace_back([this, i] { this->run(i); });
+        }
+    }
+
+    ~work_stealing_pool() {
+        stopping_.store(true, std::memory_order_seq_cst);
+        epoch_.fetch_add(1, std::memory_order_seq_cst);
+        epoch_.notify_all();
+        for (auto &t : threads_) {
+            t.join();
+        }
+    }
+
+    work_stealing_pool(const work_stealing_pool &)            = delete;
+    work_stealing_pool &operator=(const work_stealing_pool &) = delete;
+
+    // Any thread
+    void schedule(pool_work *work) {
+        if (current_ && current_->pool == this) {
+            current_->deque.push(work);
+        } else {
+            this->inject(work);
+        }
+        this->wake_one();
+    }
+
+    // Any thread, bypasses the worker deques so all other queued work of the calling worker gets to run first
+    void schedule_fifo(pool_work *work) {
+        this->inject(work);
+        this->wake_one();
+    }
+
+    std::size_t size() const { return workers_.size(); }
+
+    // True on the threads of this pool
+    bool running_in_this_thread() const { return current_ && current_->pool == this; }
+
+  private:
+    struct alignas(cache_line_size) worker {
+        chase_lev_deque<pool_work> deque;
+        work_stealing_pool        *pool{nullptr};
+        std::uint32_t              seed{0};
+    };
+
+    void run(std::size_t index) {
+        auto &self = workers_[index];
+        self.pool  = this;
+        self.seed  = static_cast<std::uint32_t>(index * 2654435761U + 1);
+        current_   = &self;
+
+        for (;;) {
+            if (auto *work = this->find_work(self)) {
+                work->execute_(work);
+                continue;
+            }
+
+            // Announce the sleep before the last look, schedule() either sees the sleeper or we see its work (Dekker)
+            auto epoch = epoch_.load(std::memory_order_seq_cst);
+            sleepers_.fetch_add(1, std::memory_order_seq_cst);
+            if (auto *work = this->find_work(self)) {
+                sleepers_.fetch_sub(1, std::memory_order_relaxed);
+                work->execute_(work);
+                continue;
+            }
+            if (stopping_.load(std::memory_order_seq_cst)) {
+                sleepers_.fetch_sub(1, std::memory_order_relaxed);
+                break;
+            }
+            epoch_.wait(epoch, std::memory_order_seq_cst);
+            sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        current_ = nullptr;
+    }
+
+    pool_work *find_work(worker &self) {
+        if (auto *work = self.deque.pop()) {
+            return work;
+        }
+        if (auto *work = this->pop_injected()) {
+            return work;
+        }
+        // xorshift, picks where to start looking so thieves spread over the victims
+        self.seed ^= self.seed << 13;
+        self.seed ^= self.seed >> 17;
+        self.seed ^= self.seed << 5;
+        auto start = self.seed % workers_.size();
+        for (std::size_t i = 0; i < workers_.size(); ++i) {
+            auto &victim = workers_[(start + i) % workers_.size()];
+            if (&victim == &self) {
+                continue;
+            }
+            if (auto *work = victim.deque.steal()) {
+                return work;
+            }
+        }
+        return nullptr;
+    }
+
+    void inject(pool_work *work) {
+        injected_count_.fetch_add(1, std::memory_order_relaxed);
+        injected_.push(work);
+    }
+
+    // The injection queue has one consumer at a time, whoever holds the lock
+    pool_work *pop_injected() {
+        if (injected_count_.load(std::memory_order_seq_cst) == 0) {
+            return nullptr;
+        }
+        std::unique_lock lock(injected_mutex_, std::try_to_lock);
+        if (!lock) {
+            return nullptr;
+        }
+        auto *work = static_cast<pool_work *>(injected_.try_pop());
+        if (work) {
+            injected_count_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return work;
+    }
+
+    void wake_one() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_relaxed) > 0) {
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+            epoch_.notify_one();
+        }
+    }
+
+    std::vector<worker>      workers_;
+    std::vector<std::thread> threads_;
+
+    alignas(cache_line_size) intrusive_mpsc_queue injected_;
+    std::atomic<std::size_t>                      injected_count_{0}; // Hint, lets idle workers skip the lock
+    std::mutex                                    injected_mutex_;
+
+    alignas(cache_line_size) std::atomic<std::uint32_t> epoch_{0};
+    std::atomic<std::uint32_t>                          sleepers_{0};
+    std::atomic<bool>                                   stopping_{false};
+
+    static inline thread_local worker *current_ = nullptr;
+};
+
+/**
+ * Awaitable that moves a SharedTask onto a work_stealing_pool, e.g.
+ *   SharedTask crunch(work_stealing_pool &pool) {
+ *       co_await schedule_on(pool);
+ *       // now on a pool thread
+ *   }
+ *
+ * The queued operation owns a reference to the task until a worker resumes it. The worker resumes through TaskImpl::try_resume(), so
+ * the state machine stays the only way into the frame: if the thread that suspended the task has not yet left TaskImpl::run() when a
+ * worker picks the operation up, the operation is queued again behind the other work instead of being run by that thread.
+ */
+class schedule_operation : pool_work {
+  public:
+    explicit schedule_operation(work_stealing_pool &pool) : pool_work(&schedule_operation::execute), pool_(pool) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    template <typename Promise>
+        requires std::convertible_to<decltype(std::declval<Promise &>().shared_from_this()), TaskImpl::Ptr>
+    void await_suspend(std::coroutine_handle<Promise> handle) {
+        task_ = handle.promise().shared_from_this();
+        pool_.schedule(this);
+    }
+
+    void await_resume() const noexcept {}
+
+  private:
+    static void execute(pool_work *work) {
+        auto *self = static_cast<schedule_operation *>(work);
+        // Owned on the worker's stack while resuming, the frame holding *self may be destroyed by the resumption
+        auto task = std::move(self->task_);
+        try {
+            if (!task->try_resume() && !task->is_done()) {
+                self->task_ = std::move(task);
+                self->pool_.schedule_fifo(self);
+            }
+        } catch (...) {
+            // The task failed on a worker, nobody here to rethrow to. It stays on the task, see TaskImpl::exception()
+        }
+    }
+
+    work_stealing_pool &pool_;
+    TaskImpl::Ptr       task_;
+};
+
+inline schedule_operation schedule_on(work_stealing_pool &pool) { return schedule_operation(pool); }
+
+} // namespace rebuild